@@ -0,0 +1,77 @@
+#ifdef TESTING
+#include "analytics.hpp"
+#include "doctest.h"
+
+TEST_CASE("stats")
+{
+    symbols s = {1, -1, 1, 1, -1, 1, -1, -1};
+    auto st = stats(s);
+    CHECK_EQ(st.max_height, 2);
+    CHECK_EQ(st.peaks, 3);
+    CHECK_EQ(st.returns, 2);
+    CHECK_EQ(st.first_return, 1);
+    CHECK_EQ(st.area, 1 + 0 + 1 + 2 + 1 + 2 + 1 + 0);
+}
+
+TEST_CASE("analyze")
+{
+    auto same = [](const path_stats& a, const path_stats& b) {
+        return a.max_height == b.max_height && a.peaks == b.peaks &&
+               a.returns == b.returns && a.first_return == b.first_return &&
+               a.area == b.area;
+    };
+
+    SUBCASE("matches stats for a batch of symbols")
+    {
+        // not a multiple of 32, and longer than a tile, and differing sizes
+        std::vector<symbols> batch;
+        for (size_t i = 0; i < 77; ++i) {
+            symbols s(1 + i % 50);
+            s.scramble();
+            s.cut_and_splice();
+            batch.push_back(s);
+        }
+        auto cols = analyze(batch);
+        REQUIRE_EQ(cols.size(), batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            CHECK(same(cols[i], stats(batch[i])));
+        }
+    }
+
+    SUBCASE("matches stats for a contiguous batch")
+    {
+        size_t n = 100, count = 40;
+        std::vector<int8_t> data;
+        for (size_t i = 0; i < count; ++i) {
+            symbols s(n);
+            s.scramble();
+            s.cut_and_splice();
+            data.insert(data.end(), s.begin(), s.end());
+        }
+        auto cols = analyze(data, 2 * n);
+        REQUIRE_EQ(cols.size(), count);
+        for (size_t i = 0; i < count; ++i) {
+            std::span<const int8_t> row(data.data() + i * 2 * n, 2 * n);
+            CHECK(same(cols[i], stats(row)));
+        }
+    }
+
+    SUBCASE("unbalanced lists")
+    {
+        std::vector<symbols> batch = {{-1, -1, 1}, {1, 1, 1, 1, 1}, {}};
+        auto cols = analyze(batch);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            CHECK(same(cols[i], stats(batch[i])));
+        }
+    }
+
+    SUBCASE("a length for every list")
+    {
+        symbols s = {1, -1};
+        const int8_t* rows[] = {s.data(), s.data()};
+        size_t lens[] = {2};
+        CHECK_THROWS_AS(analyze(rows, lens), std::invalid_argument);
+    }
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef ANALYTICS_HPP
+#define ANALYTICS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "balance.hpp"
+
+// shape statistics of balanced lists, read as paths of up (1) and down (-1)
+// steps. `area` is the sum of the heights after every step.
+
+// statistics of one list.
+struct path_stats {
+    int max_height = 0;
+    int peaks = 0;        // a 1 immediately followed by a -1
+    int returns = 0;      // times the path comes back down to 0
+    int first_return = 0; // half the index at which it first returns to 0
+    long area = 0;
+};
+
+// computes all the statistics of one list in a single pass.
+inline path_stats stats(std::span<const int8_t> s)
+{
+    path_stats st;
+    int h = 0;
+    int8_t prev = -1;
+    for (size_t i = 0; i < s.size(); ++i) {
+        h += s[i];
+        st.max_height = std::max(st.max_height, h);
+        st.peaks += prev == 1 && s[i] == -1;
+        if (h == 0) {
+            if (st.returns++ == 0) {
+                st.first_return = (i + 1) / 2;
+            }
+        }
+        st.area += h;
+        prev = s[i];
+    }
+    return st;
+}
+
+// statistics of a batch of lists, one array per statistic.
+struct path_columns {
+    std::vector<int> max_height;
+    std::vector<int> peaks;
+    std::vector<int> returns;
+    std::vector<int> first_return;
+    std::vector<long> area;
+
+    size_t size() const { return max_height.size(); }
+
+    path_stats operator[](size_t i) const
+    {
+        return {max_height[i], peaks[i], returns[i], first_return[i],
+                area[i]};
+    }
+};
+
+namespace detail {
+
+// number of lists processed side by side: one lane each
+constexpr size_t LANES = 32;
+// number of steps transposed at a time
+constexpr size_t TILE = 64;
+
+// gcc vector extensions, split into whatever registers the target has
+typedef int8_t lanes8 __attribute__((vector_size(LANES)));
+typedef int16_t lanes16 __attribute__((vector_size(LANES * 2)));
+typedef int32_t lanes32 __attribute__((vector_size(LANES * 4)));
+
+// computes the statistics of up to 32 lists at once, vertically: step i of
+// every list is in one vector, so each step is a handful of vector
+// instructions for all of the lists.
+//
+// the lists are transposed a tile at a time into a small buffer first so the
+// vector loads are contiguous. lanes past `nlanes` or the end of their list
+// read 0 steps and are masked out.
+inline void analyze_lanes(const int8_t* const* rows, const size_t* lens,
+                          size_t nlanes, path_columns& out, size_t at)
+{
+    size_t maxlen = *std::max_element(lens, lens + nlanes);
+
+    lanes16 len{};
+    for (size_t l = 0; l < nlanes; ++l) {
+        len[l] = lens[l];
+    }
+
+    lanes16 h{}, maxh{}, peaks{}, returns{}, first{};
+    lanes16 prev = lanes16{} - 1;
+    lanes32 area{};
+
+    alignas(64) int8_t tile[TILE][LANES];
+    for (size_t i0 = 0; i0 < maxlen; i0 += TILE) {
+        size_t nt = std::min(TILE, maxlen - i0);
+        for (size_t l = 0; l < LANES; ++l) {
+            for (size_t t = 0; t < nt; ++t) {
+                tile[t][l] = l < nlanes && i0 + t < lens[l] ? rows[l][i0 + t]
+                                                           : 0;
+            }
+        }
+        for (size_t t = 0; t < nt; ++t) {
+            lanes8 x8;
+            std::copy_n(tile[t], LANES, reinterpret_cast<int8_t*>(&x8));
+            lanes16 x = __builtin_convertvector(x8, lanes16);
+            const int16_t idx = i0 + t + 1;
+            lanes16 active = idx <= len;
+
+            h += x;
+            maxh = h > maxh ? h : maxh;
+            // comparisons are -1 where true
+            peaks -= (prev == 1) & (x == -1);
+            lanes16 ret = (h == 0) & active;
+            returns -= ret;
+            first = (first == 0) & ret ? lanes16{} + idx / 2 : first;
+            area += __builtin_convertvector(h & active, lanes32);
+            prev = x;
+        }
+    }
+
+    for (size_t l = 0; l < nlanes; ++l) {
+        out.max_height[at + l] = maxh[l];
+        out.peaks[at + l] = peaks[l];
+        out.returns[at + l] = returns[l];
+        out.first_return[at + l] = first[l];
+        out.area[at + l] = area[l];
+    }
+}
+
+} // namespace detail
+
+// computes the statistics of every list in `batch`, 32 lists at a time.
+//
+// heights are kept in 16 bits and areas in 32, so lists can be at most 32767
+// symbols long. `lens[i]` is the length of `rows[i]`.
+inline path_columns analyze(std::span<const int8_t* const> rows,
+                            std::span<const size_t> lens)
+{
+    if (rows.size() != lens.size()) {
+        throw std::invalid_argument(
+            "different numbers of lists and lengths to analyze");
+    }
+    path_columns out;
+    out.max_height.resize(rows.size());
+    out.peaks.resize(rows.size());
+    out.returns.resize(rows.size());
+    out.first_return.resize(rows.size());
+    out.area.resize(rows.size());
+
+    for (const auto& len : lens) {
+        if (len > INT16_MAX) {
+            throw std::runtime_error("list too long to analyze");
+        }
+    }
+    for (size_t at = 0; at < rows.size(); at += detail::LANES) {
+        size_t nlanes = std::min(detail::LANES, rows.size() - at);
+        detail::analyze_lanes(&rows[at], &lens[at], nlanes, out, at);
+    }
+    return out;
+}
+
+// `analyze` over `count` lists of `len` symbols stored back to back.
+inline path_columns analyze(std::span<const int8_t> data, size_t len)
+{
+    size_t count = len == 0 ? 0 : data.size() / len;
+    std::vector<const int8_t*> rows(count);
+    for (size_t i = 0; i < count; ++i) {
+        rows[i] = data.data() + i * len;
+    }
+    std::vector<size_t> lens(count, len);
+    return analyze(rows, lens);
+}
+
+// `analyze` over a batch of symbols, which may differ in length.
+inline path_columns analyze(std::span<const symbols> batch)
+{
+    std::vector<const int8_t*> rows;
+    std::vector<size_t> lens;
+    rows.reserve(batch.size());
+    lens.reserve(batch.size());
+    for (const auto& s : batch) {
+        rows.push_back(s.data());
+        lens.push_back(s.size());
+    }
+    return analyze(rows, lens);
+}
+
+#endif
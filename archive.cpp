@@ -0,0 +1,176 @@
+#ifdef TESTING
+#include <algorithm>
+#include <filesystem>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "archive.hpp"
+#include "doctest.h"
+#include "views.hpp"
+
+TEST_CASE("rank_codec")
+{
+    SUBCASE("uses ceil(log2 C_n) bits")
+    {
+        CHECK_EQ(rank_codec(1).bits(), 0);
+        CHECK_EQ(rank_codec(2).bits(), 1);
+        CHECK_EQ(rank_codec(4).bits(), 4);   // C_4 = 14
+        CHECK_EQ(rank_codec(20).bits(), 33); // C_20 = 6564120420
+        CHECK_EQ(rank_codec(64).bits(), 119);
+        CHECK_EQ(rank_codec(65).bits(), 121);
+        CHECK_EQ(rank_codec(800).bits(), 1585);
+        CHECK_THROWS_AS(rank_codec(rank_codec::MAX_N + 1),
+                        std::runtime_error);
+        CHECK_THROWS_AS(rank_codec(0), std::runtime_error);
+    }
+
+    SUBCASE("span ranks agree with word ranks")
+    {
+        const catalan_table tbl(6);
+        const rank_codec codec(6);
+        for_each_dyck(
+            6,
+            [&](uint64_t r, dyck_word w) {
+                symbols s = from_word(w, 12);
+                CHECK(codec.rank(s) == r);
+                symbols back(12, 0);
+                codec.unrank(r, back);
+                CHECK_EQ(back, s);
+            },
+            1);
+    }
+
+    SUBCASE("batches round trip")
+    {
+        for (size_t n : {1, 3, 20, 33, 64, 65, 100, 300}) {
+            const size_t count = 37;
+            std::vector<int8_t> lists;
+            for (const auto& s :
+                 views::balanced(n, n) | std::views::take(count)) {
+                lists.insert(lists.end(), s.begin(), s.end());
+            }
+            const rank_codec codec(n);
+            std::vector<uint8_t> bits(codec.encoded_size(count + 3));
+            // start part way into a byte
+            codec.encode(lists, bits, 3);
+            std::vector<int8_t> back(lists.size());
+            codec.decode(bits, 3, back);
+            CHECK_EQ(back, lists);
+        }
+    }
+
+    SUBCASE("ranks past 128 bits")
+    {
+        // the first and last lists of size 65 rank 0 and C_65 - 1
+        const rank_codec codec(65);
+        std::vector<int8_t> lists(4 * 65, 1);
+        for (size_t i = 1; i < 130; i += 2) {
+            lists[i] = -1;
+        }
+        std::fill(lists.begin() + 130 + 65, lists.end(), -1);
+        std::vector<uint8_t> bits(codec.encoded_size(2));
+        codec.encode(lists, bits);
+        CHECK_EQ(detail::get_bits(bits.data(), 0, 56), 0);
+        CHECK_EQ(detail::get_bits(bits.data(), 56, 56), 0);
+        CHECK_EQ(detail::get_bits(bits.data(), 112, 9), 0);
+        // C_65 - 1 = 0x1156a1e6467bc5fa4deef56bfd61305
+        CHECK_EQ(detail::get_bits(bits.data(), 121, 9), 0x115);
+        CHECK_EQ(detail::get_bits(bits.data(), 130, 56), 0x6a1e6467bc5fa4);
+        CHECK_EQ(detail::get_bits(bits.data(), 186, 56), 0xdeef56bfd61305);
+        std::vector<int8_t> back(lists.size());
+        codec.decode(bits, 0, back);
+        CHECK_EQ(back, lists);
+
+        CHECK_THROWS_AS(codec.rank(std::span(lists).first(130)),
+                        std::runtime_error);
+        // 2^121 - 1 is past C_65 - 1, so isn't a rank
+        std::fill(bits.begin(), bits.end(), 0xff);
+        CHECK_THROWS_AS(codec.decode(bits, 1, std::span(back).first(130)),
+                        std::runtime_error);
+    }
+
+    SUBCASE("refuses unbalanced lists")
+    {
+        symbols s = {1, -1, -1, 1};
+        std::vector<uint8_t> bits(1);
+        CHECK_THROWS_AS(rank_codec(2).encode(s, bits), std::runtime_error);
+        std::vector<int8_t> ups(200, 1);
+        bits.resize(rank_codec(100).encoded_size(1));
+        CHECK_THROWS_AS(rank_codec(100).encode(ups, bits), std::runtime_error);
+    }
+}
+
+TEST_CASE("archive files")
+{
+    auto dir = std::filesystem::temp_directory_path();
+    std::string path = dir / "lab4test_archive.bin";
+
+    for (size_t n : {2, 10, 50, 100}) {
+        // more than a batch so one is written out whole
+        stream_header h{n, archive_writer::BATCH + 100, 9, engine::mt19937};
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        REQUIRE(fd >= 0);
+        archive_writer out(fd, h);
+        std::vector<symbols> kept;
+        for (const auto& s :
+             views::balanced(h.n, h.seed) | std::views::take(h.count)) {
+            out.write(s);
+            if (kept.size() < 10) {
+                kept.push_back(s);
+            }
+        }
+        CHECK_THROWS_AS(out.write(kept[0]), std::runtime_error);
+        out.finish();
+        ::close(fd);
+
+        // smaller than the same lists as a stream
+        CHECK_LT(std::filesystem::file_size(path),
+                 stream_header::SIZE + h.count * h.record_size());
+
+        archive_reader in(path);
+        CHECK_EQ(in.header(), h);
+        REQUIRE_EQ(in.size(), h.count);
+        for (size_t i = 0; i < kept.size(); ++i) {
+            CHECK_EQ(in.at(i), kept[i]);
+        }
+
+        // random access agrees with regenerating from the seed
+        size_t i = 0;
+        for (const auto& s :
+             views::balanced(h.n, h.seed) | std::views::take(h.count)) {
+            if (i % 997 == 0 || i + 1 == h.count) {
+                CHECK_EQ(in.at(i), s);
+            }
+            ++i;
+        }
+        CHECK_THROWS_AS(in.at(h.count), std::runtime_error);
+    }
+
+    SUBCASE("the count must match")
+    {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        archive_writer out(fd, stream_header{3, 2, 0, engine::mt19937});
+        out.write(symbols{1, -1, 1, -1, 1, -1});
+        // neither two lists nor none count as one
+        std::vector<int8_t> two(12, 1);
+        for (size_t i = 1; i < two.size(); i += 2) {
+            two[i] = -1;
+        }
+        CHECK_THROWS_AS(out.write(two), std::runtime_error);
+        CHECK_THROWS_AS(out.write(symbols{1, -1}), std::runtime_error);
+        CHECK_THROWS_AS(out.finish(), std::runtime_error);
+        ::close(fd);
+        CHECK_THROWS_AS(
+            archive_writer(fd, stream_header{3, stream_header::UNBOUNDED, 0,
+                                             engine::mt19937}),
+            std::runtime_error);
+    }
+
+    std::filesystem::remove(path);
+}
+
+#endif
@@ -1,4 +1,10 @@
 #ifdef TESTING
+#include <array>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
 #include "doctest.h"
 #include "balance.hpp"
 
@@ -70,4 +76,104 @@ TEST_CASE("symbols class")
     }
 }
 
+TEST_CASE("span kernels")
+{
+    SUBCASE("scramble draws as symbols::scramble")
+    {
+        symbols s(8);
+        std::array<int8_t, 17> a;
+        std::copy(s.begin(), s.end(), a.begin());
+        std::mt19937 g1(5), g2(5);
+        s.scramble(g1);
+        scramble(std::span<int8_t>(a), g2);
+        CHECK(std::equal(s.begin(), s.end(), a.begin(), a.end()));
+    }
+
+    SUBCASE("lowest_valley and hilo")
+    {
+        const int8_t a[] = {1, -1, -1, 1, -1, -1, 1, 1, -1};
+        CHECK_EQ(lowest_valley(a), 5);
+        CHECK_EQ(hilo(a), std::pair{1, -2});
+        CHECK_EQ(hilo(std::span<const int8_t>(a, 1)), std::pair{1, 0});
+    }
+
+    SUBCASE("cut_and_splice_into a buffer of the caller's")
+    {
+        const int8_t in[] = {-1, 1, -1, -1, 1, 1, 1, -1, -1};
+        int8_t out[8];
+        cut_and_splice_into(in, out);
+        const int8_t want[] = {1, 1, 1, -1, -1, -1, 1, -1};
+        CHECK(std::equal(out, out + 8, want));
+        CHECK(non_neg_prefix_sum(std::span<const int8_t>(out)));
+
+        symbols s(in, in + 9);
+        s.cut_and_splice();
+        CHECK(std::equal(s.begin(), s.end(), want, want + 8));
+
+        CHECK_THROWS(cut_and_splice_into(in, std::span<int8_t>(out, 7)));
+        CHECK_THROWS(cut_and_splice_into({}, {}));
+    }
+}
+
+// pearson's chi-square of how often each ordering of 0..4 comes out of
+// `shuffle`, against all 120 equally likely
+template<class F>
+static double chi_square_of_orderings(F shuffle)
+{
+    const size_t per = 200, cells = 120;
+    std::vector<std::array<int8_t, 5>> lists(per * cells, {0, 1, 2, 3, 4});
+    shuffle(lists);
+    std::map<std::array<int8_t, 5>, size_t> seen;
+    for (const auto& l : lists) {
+        ++seen[l];
+    }
+    double chi = double(cells - seen.size()) * per;
+    for (const auto& [l, k] : seen) {
+        chi += (double(k) - per) * (double(k) - per) / per;
+    }
+    return chi;
+}
+
+TEST_CASE("scramble_batch")
+{
+    // 119 degrees of freedom, so it only goes over 180 once in 10000
+    const double limit = 180;
+
+    SUBCASE("every ordering as often as scramble gives it")
+    {
+        std::mt19937 g(11);
+        using lists = std::vector<std::array<int8_t, 5>>;
+        double one = chi_square_of_orderings([&](lists& ls) {
+            for (auto& l : ls) {
+                scramble(std::span<int8_t>(l), g);
+            }
+        });
+        double batch = chi_square_of_orderings(
+            [&](lists& ls) { scramble_batch(ls, g); });
+        CHECK_LT(one, limit);
+        CHECK_LT(batch, limit);
+
+        std::mt19937_64 g64(11);
+        CHECK_LT(chi_square_of_orderings(
+                     [&](lists& ls) { scramble_batch(ls, g64); }),
+                 limit);
+    }
+
+    SUBCASE("lists of different lengths")
+    {
+        std::vector<symbols> syms;
+        for (size_t n = 0; n < 20; ++n) {
+            syms.emplace_back(n);
+        }
+        std::mt19937 g(3);
+        symbols::scramble_batch(syms, g);
+        for (size_t n = 0; n < 20; ++n) {
+            CHECK_EQ(syms[n].size(), 2 * n + 1);
+            CHECK_EQ(std::accumulate(syms[n].begin(), syms[n].end(), 0), -1);
+        }
+        // a list of 41 is left in order by a scramble once in 10^32 or so
+        CHECK_NE(syms.back(), symbols(19));
+    }
+}
+
 #endif
@@ -2,24 +2,209 @@
 #define BALANCE_HPP
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <iterator>
 #include <vector>
 #include <iostream>
 #include <random>
+#include <ranges>
 #include <numeric>
 #include <functional>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <string_view>
 
 #include "prefix.hpp"
 
+// the operations on a list of symbols, on memory the caller owns: a mapped
+// file, an arena, a network buffer. `symbols` wraps these for its own
+// vector.
+
+// the in-place Fisher-Yates scramble of `s`, drawing from `g`.
+//
+// `bias` = true will bias the results for use in testing.
+template<std::uniform_random_bit_generator G>
+void scramble(std::span<int8_t> s, G& g, bool bias = false)
+{
+    auto dist = [=](size_t a, auto& rd) {
+        if (!bias) {
+            return std::uniform_int_distribution<size_t>(0, a)(rd);
+        }
+        else {
+            return std::binomial_distribution<size_t>(a, 0.5)(rd);
+        }
+    };
+    for (size_t i = s.size(); i-- > 1;) {
+        auto n = dist(i, g);
+        std::swap(s[i], s[n]);
+    }
+}
+
+namespace detail {
+
+// random 32 bit words from `g`, drawn a block at a time, or filled in one
+// call if the engine has `fill(std::span<result_type>)`.
+template<std::uniform_random_bit_generator G>
+class word_block {
+public:
+    static constexpr size_t SIZE = 256;
+
+    explicit word_block(G& g) : g(g) {}
+
+    // a uniform integer in [0, range), by lemire's nearly divisionless
+    // method: the high half of a word times the range, redrawn in the rare
+    // case the low half lands where the range doesn't divide evenly.
+    uint32_t below(uint32_t range)
+    {
+        uint64_t m = uint64_t(next()) * range;
+        if (uint32_t(m) < range) {
+            uint32_t floor = -range % range;
+            while (uint32_t(m) < floor) {
+                m = uint64_t(next()) * range;
+            }
+        }
+        return m >> 32;
+    }
+
+    uint32_t next()
+    {
+        if (pos == SIZE) {
+            refill();
+            pos = 0;
+        }
+        size_t k = pos++;
+        if constexpr (WIDE) {
+            return uint32_t(buf[k / 2] >> (32 * (k % 2)));
+        }
+        else {
+            return buf[k];
+        }
+    }
+
+private:
+    static constexpr bool WIDE =
+        G::max() == std::numeric_limits<uint64_t>::max();
+    static_assert(G::min() == 0 && (WIDE || G::max() == 0xffffffffu),
+                  "engine must make whole 32 or 64 bit words");
+    using word = std::conditional_t<WIDE, uint64_t, uint32_t>;
+
+    void refill()
+    {
+        if constexpr (requires(std::span<word> s) { g.fill(s); }) {
+            g.fill(std::span<word>(buf));
+        }
+        else {
+            for (auto& w : buf) {
+                w = word(g());
+            }
+        }
+    }
+
+    G& g;
+    std::array<word, WIDE ? SIZE / 2 : SIZE> buf;
+    size_t pos = SIZE;
+};
+
+} // namespace detail
+
+// scrambles every list in `lists` as `scramble` does each one, with the same
+// distribution but not the same draws.
+//
+// the random words come a block at a time instead of through a
+// distribution per index, and eight lists are scrambled side by side so the
+// swaps of one don't wait on the draws of the next.
+template<std::ranges::random_access_range R,
+         std::uniform_random_bit_generator G>
+    requires std::convertible_to<std::ranges::range_reference_t<R>,
+                                 std::span<int8_t>>
+void scramble_batch(R&& lists, G& g)
+{
+    constexpr size_t LANES = 8;
+    detail::word_block<G> words(g);
+    const size_t count = std::ranges::size(lists);
+    for (size_t first = 0; first < count; first += LANES) {
+        const size_t lanes = std::min(LANES, count - first);
+        std::span<int8_t> s[LANES];
+        size_t longest = 0;
+        for (size_t l = 0; l < lanes; ++l) {
+            s[l] = lists[first + l];
+            if (s[l].size() > std::numeric_limits<uint32_t>::max()) {
+                // too long for 32 bit draws, and for interleaving to matter
+                scramble(s[l], g);
+                s[l] = {};
+            }
+            longest = std::max(longest, s[l].size());
+        }
+        for (size_t i = longest; i-- > 1;) {
+            // all the draws, then all the swaps, so stores to the lists
+            // don't hold up the next draw
+            uint32_t j[LANES];
+            for (size_t l = 0; l < lanes; ++l) {
+                j[l] = i < s[l].size() ? words.below(i + 1) : 0;
+            }
+            for (size_t l = 0; l < lanes; ++l) {
+                if (i < s[l].size()) {
+                    std::swap(s[l][i], s[l][j[l]]);
+                }
+            }
+        }
+    }
+}
+
+// index of the lowest valley, where the prefix sum first reaches its minimum
+//
+// the prefix sums are summarized (across threads when long) to find the
+// lowest, then walked again to find where it first happens.
+inline size_t lowest_valley(std::span<const int8_t> s)
+{
+    if (s.size() >= PARALLEL_THRESHOLD) {
+        return parallel_lowest_valley(s);
+    }
+    return first_prefix_at(s, summarize(s).min);
+}
+
+// the [P2:P1'] splice of `in` into `out`, which must be one shorter: what
+// follows the lowest valley, then what precedes it.
+inline void cut_and_splice_into(std::span<const int8_t> in,
+                                std::span<int8_t> out)
+{
+    if (in.empty() || out.size() != in.size() - 1) {
+        throw std::runtime_error("splice needs room for all but one symbol");
+    }
+    size_t i = lowest_valley(in);
+    // exclude i itself as thats the final -1 edge
+    auto tail = std::copy(in.begin() + i + 1, in.end(), out.begin());
+    std::copy(in.begin(), in.begin() + i, tail);
+}
+
+// returns the highest and lowest values of the partial sums of `s`.
+inline std::pair<int, int> hilo(std::span<const int8_t> s)
+{
+    auto sums = s.size() >= PARALLEL_THRESHOLD ? parallel_summarize(s)
+                                               : summarize(s);
+    int high = sums.max < 0 ? 0 : sums.max;
+    int low = sums.min > 0 ? 0 : sums.min;
+
+    return {high, low};
+}
+
 // represents a list of symbols.
 //
 // could have templated on symbol type but it made list-init a pain.
-class symbols : public std::vector<int8_t> {
+//
+// the storage comes from a `std::pmr::memory_resource`, the default one
+// (global new) unless given, so batches of lists can share an arena.
+class symbols : public std::pmr::vector<int8_t> {
 public:
-    using std::vector<int8_t>::vector;
+    using std::pmr::vector<int8_t>::vector;
 
     // create a list of symbols of `n` 1s and `n+1` -1s
-    explicit symbols(size_t n) : vector(2 * n + 1)
+    explicit symbols(size_t n, const allocator_type& alloc = {})
+        : vector(2 * n + 1, alloc)
     {
         auto b = begin();
         auto h = b + n;
@@ -39,62 +224,58 @@ public:
     // statistical bias whereas `uniform_int_distribution` does not.
     //
     // `bias` = true will bias the results for use in testing.
-    void scramble(bool bias = false)
+    void scramble(bool bias = false) { scramble(rd, bias); }
+
+    // as above, drawing from `g` instead of the shared generator so streams
+    // of lists can be reproduced from a seed.
+    template<std::uniform_random_bit_generator G>
+    void scramble(G& g, bool bias = false)
     {
-        auto dist = [=](size_t a, auto& rd) {
-            if (!bias) {
-                return std::uniform_int_distribution<size_t>(0, a)(rd);
-            }
-            else {
-                return std::binomial_distribution<size_t>(a, 0.5)(rd);
-            }
-        };
-        for (size_t i = size() - 1; i > 0; --i) {
-            auto n = dist(i, rd);
-            std::swap((*this)[i], (*this)[n]);
-        }
+        ::scramble(std::span<int8_t>(*this), g, bias);
+    }
+
+    // scrambles every list in `batch` at once, see `::scramble_batch`
+    static void scramble_batch(std::span<symbols> batch)
+    {
+        scramble_batch(batch, rd);
+    }
+
+    template<std::uniform_random_bit_generator G>
+    static void scramble_batch(std::span<symbols> batch, G& g)
+    {
+        ::scramble_batch(batch, g);
     }
 
     // returns a const_iterator to the lowest valley
     vector::const_iterator lowest_valley() const
     {
-        // int because the sums could be larger than int8_t
-        std::vector<int> sums;
-        std::partial_sum(cbegin(), cend(), std::back_inserter(sums));
-        auto m = std::min_element(sums.cbegin(), sums.cend());
-        return cbegin() + std::distance(sums.cbegin(), m);
+        return cbegin() + ::lowest_valley(*this);
     }
 
     // performs the [P2:P1'] splicing from the assignment algorithm.
+    //
+    // rotates in place, so it never allocates.
     void cut_and_splice()
     {
-        auto i = lowest_valley();
-        // exclude i itself as thats the final -1 edge
-        std::vector<int8_t> p2(i + 1, cend());
-        p2.insert(p2.end(), cbegin(), i);
-        vector::operator=(std::move(p2));
+        auto i = begin() + ::lowest_valley(*this);
+        // P2 then P1, leaving the valley's -1 last where it's dropped
+        std::rotate(begin(), i + 1, end());
+        pop_back();
     }
 
-    // generate `nsyms` symbols of size `2n+1`
-    static std::vector<symbols> generate_n(size_t n, size_t nsyms)
+    // generate `nsyms` symbols of size `2n+1`, the vector and every list
+    // allocated from `mr`
+    static std::pmr::vector<symbols>
+    generate_n(size_t n, size_t nsyms,
+               std::pmr::memory_resource* mr = std::pmr::get_default_resource())
     {
-        const symbols sym(n);
-        std::vector<symbols> syms(nsyms, sym);
+        const symbols sym(n, mr);
+        std::pmr::vector<symbols> syms(nsyms, sym, mr);
         return syms;
     }
 
     // returns the highest and lowest values of the partial sums.
-    std::pair<int, int> hilo() const
-    {
-        std::vector<int> sums;
-        std::partial_sum(cbegin(), cend(), std::back_inserter(sums));
-        int high = *std::max_element(sums.cbegin(), sums.cend());
-        high = high < 0 ? 0 : high;
-        int low = *std::min_element(sums.cbegin(), sums.cend());
-        low = low > 0 ? 0 : low;
-
-        return {high, low};
-    }
+    std::pair<int, int> hilo() const { return ::hilo(*this); }
 
     // this assignment was pretty easy so as a fun challenge I wrote this to
     // print the symbols like the graph from the assignment sheet.
@@ -163,17 +344,6 @@ public:
     friend std::hash<symbols>;
 
 private:
-    // returns a string representation of the sequence appropriate for hashing
-    std::string to_string() const
-    {
-        std::string repr;
-        repr.reserve(size());
-        std::ranges::transform(
-            *this, std::back_inserter(repr),
-            [](const int8_t& x) { return x == 1 ? '1' : '0'; });
-        return repr;
-    }
-
     // returns a uint64_t suitable for hashing. used when size() < 64
     size_t to_bits() const
     {
@@ -202,7 +372,10 @@ struct std::hash<symbols> {
     size_t operator()(const symbols& s) const noexcept
     {
         if (s.size() > sizeof(size_t) * 8) {
-            return std::hash<std::string>{}(s.to_string());
+            // the bytes as they are, rather than a copy to hash
+            std::string_view bytes(reinterpret_cast<const char*>(s.data()),
+                                   s.size());
+            return std::hash<std::string_view>{}(bytes);
         }
         else {
             return std::hash<size_t>{}(s.to_bits());
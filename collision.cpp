@@ -0,0 +1,65 @@
+#ifdef TESTING
+#include <unordered_set>
+
+#include "collision.hpp"
+#include "doctest.h"
+#include "enumerate.hpp"
+
+TEST_CASE("fingerprint")
+{
+    SUBCASE("distinct for every list of size n")
+    {
+        size_t n = 8;
+        std::unordered_set<uint64_t> prints;
+        for_each_dyck(
+            n,
+            [&](uint64_t, dyck_word w) {
+                prints.insert(fingerprint(from_word(w, 2 * n)));
+            },
+            1);
+        CHECK_EQ(prints.size(), catalan(n));
+    }
+
+    SUBCASE("depends on every symbol of long lists")
+    {
+        symbols s(100);
+        uint64_t fp = fingerprint(s);
+        std::swap(s[99], s[100]);
+        CHECK_NE(fingerprint(s), fp);
+        s.pop_back();
+        CHECK_NE(fingerprint(s), fp);
+    }
+}
+
+TEST_CASE("log_catalan")
+{
+    CHECK_EQ(log_catalan(4), doctest::Approx(std::log(14.0)));
+    CHECK_EQ(log_catalan(30), doctest::Approx(std::log(3814986502092304.0)));
+}
+
+TEST_CASE("birthday_test")
+{
+    SUBCASE("uniform")
+    {
+        auto r = birthday_test(4, 2000);
+        CHECK_EQ(r.expected, doctest::Approx(2000 * 1999 / 2 / 14.0));
+        CHECK(r.pass);
+    }
+
+    SUBCASE("biased")
+    {
+        auto r = birthday_test(4, 2000, 0.01, true);
+        CHECK_GT(r.collisions, r.expected);
+        CHECK_FALSE(r.pass);
+    }
+
+    SUBCASE("astronomically many lists")
+    {
+        auto r = birthday_test(1000, 2000);
+        CHECK_EQ(r.collisions, 0);
+        CHECK_EQ(r.p_value, 1.0);
+        CHECK(r.pass);
+    }
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef COLLISION_HPP
+#define COLLISION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "balance.hpp"
+#include "enumerate.hpp"
+
+// birthday-collision uniformity test.
+//
+// only stores a 64-bit fingerprint per sample, so it works for any n, even
+// when C_n is far too large to ever fill a table.
+
+// 64-bit fingerprint of a list. packs 64 symbols at a time into a word and
+// mixes them together with the splitmix64 finalizer.
+inline uint64_t fingerprint(const symbols& s)
+{
+    auto mix = [](uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    };
+    uint64_t h = mix(s.size());
+    uint64_t word = 0;
+    size_t i = 0;
+    for (const auto& x : s) {
+        word = (word << 1) | (x == 1 ? 1 : 0);
+        if (++i % 64 == 0) {
+            h = mix(h ^ word);
+            word = 0;
+        }
+    }
+    if (i % 64 != 0) {
+        h = mix(h ^ word);
+    }
+    return h;
+}
+
+// P(X >= k) when X is the number of colliding pairs with mean `mean` and
+// variance `var`.
+//
+// poisson when collisions are rare, otherwise normal (the pairs are pairwise
+// independent so `var` is exact).
+inline double collision_p_value(uint64_t k, double mean, double var)
+{
+    if (k == 0) {
+        return 1.0;
+    }
+    if (mean < 30) {
+        double p = 0.0;
+        for (uint64_t i = k;; ++i) {
+            double term = std::exp(-mean + i * std::log(mean) -
+                                   std::lgamma(i + 1.0));
+            p += term;
+            if (i > mean && term <= p * 1e-17) {
+                break;
+            }
+        }
+        return std::min(p, 1.0);
+    }
+    double z = (k - 0.5 - mean) / std::sqrt(var);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+struct collision_result {
+    size_t samples;
+    uint64_t collisions; // number of colliding pairs
+    double expected;     // expected colliding pairs if uniform
+    double p_value;      // chance of at least `collisions` if uniform
+    bool pass;
+};
+
+// counts the colliding pairs among the fingerprints of `m` balanced lists of
+// size `n` and compares it against the number expected if the lists were
+// uniform over all C_n of them.
+//
+// a biased scrambler favours some lists, which makes collisions more likely,
+// so the test is one-sided and fails when `p_value < alpha`.
+inline collision_result birthday_test(size_t n, size_t m, double alpha = 0.01,
+                                      bool bias = false)
+{
+    std::vector<uint64_t> prints;
+    prints.reserve(m);
+
+    const symbols init(n);
+    symbols s;
+    for (size_t i = 0; i < m; ++i) {
+        s.assign(init.begin(), init.end());
+        s.scramble(bias);
+        s.cut_and_splice();
+        prints.push_back(fingerprint(s));
+    }
+    std::ranges::sort(prints);
+
+    uint64_t collisions = 0;
+    for (auto it = prints.begin(); it != prints.end();) {
+        auto run = std::find_if(it, prints.end(),
+                                [=](uint64_t x) { return x != *it; });
+        uint64_t r = run - it;
+        collisions += r * (r - 1) / 2;
+        it = run;
+    }
+
+    // a pair collides if the lists are equal or, rarely, their fingerprints
+    double p = std::exp(-log_catalan(n)) + std::ldexp(1.0, -64);
+    double pairs = m * (m - 1.0) / 2;
+    double mean = pairs * p;
+    double pv = collision_p_value(collisions, mean, mean * (1 - p));
+
+    return {m, collisions, mean, pv, pv >= alpha};
+}
+
+#endif
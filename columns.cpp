@@ -0,0 +1,68 @@
+#ifdef TESTING
+#include "columns.hpp"
+#include "doctest.h"
+
+TEST_CASE("column_batch")
+{
+    // scrambled but not balanced, so the kernels see negative sums too.
+    // not a multiple of 64 lists.
+    size_t n = 6, count = 150;
+    auto made = symbols::generate_n(n, count);
+    std::vector<symbols> syms(made.begin(), made.end());
+    for (size_t i = 0; i < count; ++i) {
+        syms[i].scramble();
+        if (i % 2) {
+            syms[i].cut_and_splice();
+            syms[i].push_back(-1);
+        }
+    }
+    auto cb = column_batch::from_symbols(syms);
+    REQUIRE_EQ(cb.size(), count);
+    REQUIRE_EQ(cb.blocks(), 3);
+
+    SUBCASE("round trips")
+    {
+        CHECK_EQ(cb.to_symbols(), syms);
+
+        std::vector<int8_t> rows(count * cb.length());
+        cb.to_rows(rows);
+        auto again = column_batch::from_rows(rows, cb.length());
+        CHECK_EQ(again.to_symbols(), syms);
+    }
+
+    SUBCASE("is_balanced")
+    {
+        auto bal = cb.is_balanced();
+        for (size_t i = 0; i < count; ++i) {
+            bool b = (bal[i / 64] >> (i % 64)) & 1;
+            CHECK_EQ(b, syms[i].is_balanced());
+        }
+        // padding lanes are never balanced
+        CHECK_EQ(bal.back() >> (count % 64), 0);
+    }
+
+    SUBCASE("lowest_valley")
+    {
+        auto valleys = cb.lowest_valley();
+        for (size_t i = 0; i < count; ++i) {
+            CHECK_EQ(valleys[i], syms[i].lowest_valley() - syms[i].cbegin());
+        }
+    }
+
+    SUBCASE("hilo")
+    {
+        auto [hi, lo] = cb.hilo();
+        for (size_t i = 0; i < count; ++i) {
+            CHECK_EQ(std::pair{hi[i], lo[i]}, syms[i].hilo());
+        }
+    }
+
+    SUBCASE("rejects long lists")
+    {
+        CHECK_THROWS(column_batch(128, 1));
+        std::vector<symbols> ragged = {symbols(2), symbols(3)};
+        CHECK_THROWS(column_batch::from_symbols(ragged));
+    }
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef COLUMNS_HPP
+#define COLUMNS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "balance.hpp"
+
+// a batch of equal-length lists stored transposed.
+//
+// lists are grouped into blocks of 64 and step i of every list in a block is
+// stored together as a 64 byte plane. for small n every list is shorter than
+// a vector register, so working across lists instead of along them is the
+// only way to fill one: each kernel below handles 64 lists per vector
+// instruction.
+//
+// heights are kept in 8 bits so lists can be at most 127 symbols long, which
+// covers n up to 63.
+class column_batch {
+public:
+    static constexpr size_t WIDTH = 64;
+
+    column_batch(size_t len, size_t count)
+        : len(len), count(count), nblocks((count + WIDTH - 1) / WIDTH),
+          planes(nblocks * len * WIDTH, 0)
+    {
+        if (len > INT8_MAX) {
+            throw std::runtime_error("lists too long for a column_batch");
+        }
+    }
+
+    // transposes `rows.size() / len` lists stored back to back
+    static column_batch from_rows(std::span<const int8_t> rows, size_t len)
+    {
+        column_batch cb(len, len == 0 ? 0 : rows.size() / len);
+        for (size_t i = 0; i < cb.count; ++i) {
+            const int8_t* row = rows.data() + i * len;
+            for (size_t j = 0; j < len; ++j) {
+                cb.plane(i / WIDTH, j)[i % WIDTH] = row[j];
+            }
+        }
+        return cb;
+    }
+
+    // transposes `syms`, which must all be the same size
+    static column_batch from_symbols(std::span<const symbols> syms)
+    {
+        size_t len = syms.empty() ? 0 : syms.front().size();
+        column_batch cb(len, syms.size());
+        for (size_t i = 0; i < cb.count; ++i) {
+            if (syms[i].size() != len) {
+                throw std::runtime_error("lists differ in length");
+            }
+            for (size_t j = 0; j < len; ++j) {
+                cb.plane(i / WIDTH, j)[i % WIDTH] = syms[i][j];
+            }
+        }
+        return cb;
+    }
+
+    // transposes back into `size() * length()` symbols stored back to back
+    void to_rows(std::span<int8_t> rows) const
+    {
+        for (size_t i = 0; i < count; ++i) {
+            int8_t* row = rows.data() + i * len;
+            for (size_t j = 0; j < len; ++j) {
+                row[j] = plane(i / WIDTH, j)[i % WIDTH];
+            }
+        }
+    }
+
+    std::vector<symbols> to_symbols() const
+    {
+        std::vector<symbols> syms(count, symbols(len, 0));
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < len; ++j) {
+                syms[i][j] = plane(i / WIDTH, j)[i % WIDTH];
+            }
+        }
+        return syms;
+    }
+
+    size_t length() const { return len; }
+    size_t size() const { return count; }
+    size_t blocks() const { return nblocks; }
+
+    // the 64 symbols at index `step` of the lists in `block`
+    int8_t* plane(size_t block, size_t step)
+    {
+        return planes.data() + (block * len + step) * WIDTH;
+    }
+    const int8_t* plane(size_t block, size_t step) const
+    {
+        return planes.data() + (block * len + step) * WIDTH;
+    }
+
+    // one bit per list, set if it has a non-negative prefix sum.
+    // `is_balanced()[i / 64] >> (i % 64) & 1` for list i.
+    std::vector<uint64_t> is_balanced() const
+    {
+        std::vector<uint64_t> out(blocks());
+        for (size_t b = 0; b < blocks(); ++b) {
+            lanes h{}, neg{}, v;
+            for (size_t j = 0; j < len; ++j) {
+                load(v, b, j);
+                h += v;
+                neg |= h < 0;
+            }
+            uint64_t bits = 0;
+            for (size_t l = 0; l < WIDTH; ++l) {
+                bits |= uint64_t(neg[l] == 0) << l;
+            }
+            out[b] = bits & valid(b);
+        }
+        return out;
+    }
+
+    // index of the (first) lowest valley of every list, as in
+    // `symbols::lowest_valley`
+    std::vector<int> lowest_valley() const
+    {
+        std::vector<int> out(count);
+        for (size_t b = 0; b < blocks(); ++b) {
+            lanes h{}, low = lanes{} + INT8_MAX, at{}, v;
+            for (size_t j = 0; j < len; ++j) {
+                load(v, b, j);
+                h += v;
+                lanes lower = h < low;
+                low = lower ? h : low;
+                at = lower ? lanes{} + int8_t(j) : at;
+            }
+            store(out, b, at);
+        }
+        return out;
+    }
+
+    // highest and lowest prefix sums of every list, as in `symbols::hilo`
+    std::pair<std::vector<int>, std::vector<int>> hilo() const
+    {
+        std::vector<int> his(count), los(count);
+        for (size_t b = 0; b < blocks(); ++b) {
+            lanes h{}, hi{}, lo{}, v;
+            for (size_t j = 0; j < len; ++j) {
+                load(v, b, j);
+                h += v;
+                hi = h > hi ? h : hi;
+                lo = h < lo ? h : lo;
+            }
+            store(his, b, hi);
+            store(los, b, lo);
+        }
+        return {his, los};
+    }
+
+private:
+    // gcc vector extension of one plane
+    typedef int8_t lanes __attribute__((vector_size(WIDTH)));
+
+    // vectors are passed by reference, so the calls don't depend on how
+    // wide a register the compiler was allowed
+    void load(lanes& v, size_t block, size_t step) const
+    {
+        std::copy_n(plane(block, step), WIDTH, reinterpret_cast<int8_t*>(&v));
+    }
+
+    void store(std::vector<int>& out, size_t block, const lanes& v) const
+    {
+        for (size_t l = 0; l < WIDTH && block * WIDTH + l < count; ++l) {
+            out[block * WIDTH + l] = v[l];
+        }
+    }
+
+    // mask of the lanes of `block` that hold a list
+    uint64_t valid(size_t block) const
+    {
+        size_t n = std::min(WIDTH, count - block * WIDTH);
+        return n == WIDTH ? ~0ull : (1ull << n) - 1;
+    }
+
+    size_t len;
+    size_t count;
+    size_t nblocks;
+    std::vector<int8_t> planes;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifdef TESTING
+#include <unordered_set>
+
+#include "doctest.h"
+#include "enumerate.hpp"
+
+TEST_CASE("catalan")
+{
+    // https://oeis.org/A000108
+    CHECK_EQ(catalan(0), 1);
+    CHECK_EQ(catalan(4), 14);
+    CHECK_EQ(catalan(10), 16796);
+    CHECK_EQ(catalan(16), 35357670);
+    CHECK_EQ(catalan(36), 11959798385860453492ull);
+
+    for (size_t n = 0; n <= MAX_WORD_N; ++n) {
+        CHECK_EQ(catalan_table(n).catalan(), catalan(n));
+    }
+}
+
+TEST_CASE("next_dyck")
+{
+    SUBCASE("n=3")
+    {
+        // all 5 in numeric order
+        std::vector<dyck_word> words = {0b101010, 0b101100, 0b110010,
+                                        0b110100, 0b111000};
+        CHECK_EQ(first_dyck(3), words.front());
+        CHECK_EQ(last_dyck(3), words.back());
+        for (size_t i = 0; i + 1 < words.size(); ++i) {
+            CHECK_EQ(next_dyck(words[i]), words[i + 1]);
+        }
+    }
+
+    SUBCASE("visits every balanced word exactly once")
+    {
+        size_t n = 8;
+        std::vector<bool> seen(1 << (2 * n));
+        dyck_word w = first_dyck(n);
+        for (size_t i = 1; i < catalan(n); ++i) {
+            CHECK_FALSE(seen[w]);
+            seen[w] = true;
+            dyck_word next = next_dyck(w);
+            CHECK_GT(next, w);
+            w = next;
+        }
+        CHECK_EQ(w, last_dyck(n));
+    }
+}
+
+TEST_CASE("for_each_dyck")
+{
+    SUBCASE("rank, unrank, and hash are consistent")
+    {
+        for (size_t n : {0, 1, 4, 10}) {
+            const catalan_table tbl(n);
+            struct check {
+                const catalan_table* tbl;
+                size_t n;
+                uint64_t count = 0;
+                bool ok = true;
+                void operator()(uint64_t rank, dyck_word w)
+                {
+                    symbols s = from_word(w, 2 * n);
+                    ok = ok && s.is_balanced() && tbl->rank(w) == rank &&
+                         tbl->unrank(rank) == w && to_word(s) == w &&
+                         (n == 0 || std::hash<symbols>{}(s) == w);
+                    ++count;
+                }
+            };
+            auto results = for_each_dyck(n, check{&tbl, n}, 3);
+            uint64_t total = 0;
+            for (const auto& r : results) {
+                CHECK(r.ok);
+                total += r.count;
+            }
+            CHECK_EQ(total, catalan(n));
+        }
+    }
+
+    SUBCASE("the sampler only produces enumerated lists")
+    {
+        size_t n = 6;
+        std::unordered_set<dyck_word> all;
+        for_each_dyck(n, [&](uint64_t, dyck_word w) { all.insert(w); }, 1);
+        CHECK_EQ(all.size(), catalan(n));
+
+        for (auto& s : symbols::generate_n(n, 1000)) {
+            s.scramble();
+            s.cut_and_splice();
+            CHECK(all.contains(to_word(s)));
+        }
+    }
+
+#ifdef FULLCHECK
+    SUBCASE("n=16")
+    {
+        struct count {
+            uint64_t n = 0;
+            void operator()(uint64_t, dyck_word) { ++n; }
+        };
+        uint64_t total = 0;
+        for (const auto& c : for_each_dyck(16, count{})) {
+            total += c.n;
+        }
+        CHECK_EQ(total, catalan(16));
+    }
+#endif
+}
+
+#endif
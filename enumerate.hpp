@@ -0,0 +1,254 @@
+#ifndef ENUMERATE_HPP
+#define ENUMERATE_HPP
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "balance.hpp"
+
+// a balanced list of size `n` (2n symbols, n <= 32) packed into a word.
+//
+// first symbol in the most significant bit, 1 for a 1 and 0 for a -1. this is
+// the same layout `symbols::to_bits` uses so the word of a list is also its
+// hash.
+using dyck_word = uint64_t;
+
+constexpr size_t MAX_WORD_N = 32;
+
+// table of ballot numbers.
+//
+// `paths(r, h)` is the number of ways to finish a balanced list with `r`
+// symbols remaining from height `h`, so `paths(2n, 0)` is the catalan number.
+//
+// templated on the count type so wider ranks can share the same code.
+template<class T>
+class basic_catalan_table {
+public:
+    explicit basic_catalan_table(size_t n)
+        : n_(n), width(n + 2), tbl((2 * n + 1) * width, 0)
+    {
+        at(0, 0) = 1;
+        for (size_t r = 1; r <= 2 * n; ++r) {
+            for (size_t h = 0; h <= n; ++h) {
+                at(r, h) = (h > 0 ? at(r - 1, h - 1) : 0) + at(r - 1, h + 1);
+            }
+        }
+    }
+
+    size_t n() const { return n_; }
+
+    T paths(size_t r, size_t h) const { return tbl[r * width + h]; }
+
+    T catalan() const { return paths(2 * n_, 0); }
+
+    // position of `w` in the numeric order of all balanced words of size n.
+    T rank(dyck_word w) const
+    {
+        T rk = 0;
+        size_t h = 0;
+        for (size_t r = 2 * n_; r-- > 0;) {
+            if ((w >> r) & 1) {
+                // every word taking a -1 here instead comes first
+                if (h > 0) {
+                    rk += paths(r, h - 1);
+                }
+                ++h;
+            }
+            else {
+                --h;
+            }
+        }
+        return rk;
+    }
+
+    // inverse of `rank`
+    dyck_word unrank(T rk) const
+    {
+        dyck_word w = 0;
+        size_t h = 0;
+        for (size_t r = 2 * n_; r-- > 0;) {
+            T down = h > 0 ? paths(r, h - 1) : 0;
+            if (rk < down) {
+                w <<= 1;
+                --h;
+            }
+            else {
+                rk -= down;
+                w = (w << 1) | 1;
+                ++h;
+            }
+        }
+        return w;
+    }
+
+    // as `rank` for a list of any size n, as long as its catalan number fits
+    // in T. throws if `s` isn't a balanced list of size n.
+    T rank(std::span<const int8_t> s) const
+    {
+        if (s.size() != 2 * n_) {
+            throw std::runtime_error("list is the wrong size to rank");
+        }
+        T rk = 0;
+        size_t h = 0;
+        for (size_t i = 0, r = 2 * n_; r-- > 0; ++i) {
+            if (s[i] == 1) {
+                if (h > 0) {
+                    rk += paths(r, h - 1);
+                }
+                ++h;
+            }
+            else if (h == 0) {
+                throw std::runtime_error("list is not balanced");
+            }
+            else {
+                --h;
+            }
+        }
+        return rk;
+    }
+
+    // inverse of `rank(std::span)`, into the 2n symbols of `out`
+    void unrank(T rk, std::span<int8_t> out) const
+    {
+        size_t h = 0;
+        for (size_t i = 0, r = 2 * n_; r-- > 0; ++i) {
+            T down = h > 0 ? paths(r, h - 1) : 0;
+            if (rk < down) {
+                out[i] = -1;
+                --h;
+            }
+            else {
+                rk -= down;
+                out[i] = 1;
+                ++h;
+            }
+        }
+    }
+
+private:
+    T& at(size_t r, size_t h) { return tbl[r * width + h]; }
+
+    size_t n_;
+    size_t width;
+    std::vector<T> tbl;
+};
+
+using catalan_table = basic_catalan_table<uint64_t>;
+
+// returns the n-th catalan number, the number of unique balanced lists.
+//
+// only exact for n <= 36, past that it overflows.
+inline uint64_t catalan(size_t n)
+{
+    uint64_t c = 1;
+    for (size_t i = 0; i < n; ++i) {
+        // C_{i+1} = C_i * 2(2i+1) / (i+2), split to delay overflow
+        c = c / (i + 2) * (2 * (2 * i + 1)) +
+            c % (i + 2) * (2 * (2 * i + 1)) / (i + 2);
+    }
+    return c;
+}
+
+// natural log of the n-th catalan number, binom(2n, n) / (n + 1). for when
+// `catalan` would overflow.
+inline double log_catalan(size_t n)
+{
+    return std::lgamma(2.0 * n + 1) - std::lgamma(n + 1.0) -
+           std::lgamma(n + 2.0);
+}
+
+// the numerically smallest balanced word of size n: {1, -1, 1, -1, ...}
+constexpr dyck_word first_dyck(size_t n)
+{
+    return n == 0 ? 0 : 0xAAAAAAAAAAAAAAAAull >> (64 - 2 * n);
+}
+
+// the numerically largest balanced word of size n: {1, 1, ..., -1, -1}
+constexpr dyck_word last_dyck(size_t n)
+{
+    return n == 0 ? 0 : ((1ull << n) - 1) << n;
+}
+
+// the next balanced word in numeric order. loopless.
+//
+// the word ends in `0 1^a 0^t`. adding the lowest set bit carries through the
+// 1s, turning it into `1 0^(a+t)`, then the a-1 leftover 1s are put back as
+// the smallest possible tail `(1 0)^(a-1)`.
+//
+// undefined for `last_dyck(n)`.
+constexpr dyck_word next_dyck(dyck_word w)
+{
+    dyck_word low = w & -w;
+    dyck_word carried = w + low;
+    int a = std::popcount(w ^ carried) - 1;
+    return carried | (0xAAAAAAAAAAAAAAAAull & ((1ull << (2 * (a - 1))) - 1));
+}
+
+inline dyck_word to_word(const symbols& s)
+{
+    dyck_word w = 0;
+    for (const auto& i : s) {
+        w = (w << 1) | (i == 1 ? 1 : 0);
+    }
+    return w;
+}
+
+inline symbols from_word(dyck_word w, size_t len)
+{
+    symbols s(len, -1);
+    for (size_t i = 0; i < len; ++i) {
+        if ((w >> (len - 1 - i)) & 1) {
+            s[i] = 1;
+        }
+    }
+    return s;
+}
+
+// calls `f(rank, word)` for every balanced word of size `n`, in numeric order
+// within each thread.
+//
+// the words are split by rank into `nthreads` contiguous chunks (i.e. by
+// prefix) and each thread unranks the start of its chunk then walks it with
+// `next_dyck`. every thread gets its own copy of `f`, which are returned so
+// the caller can combine whatever they accumulated.
+template<class F>
+std::vector<F> for_each_dyck(size_t n, F f,
+                             size_t nthreads = std::thread::hardware_concurrency())
+{
+    if (n > MAX_WORD_N) {
+        throw std::runtime_error("n too large to enumerate");
+    }
+    const catalan_table tbl(n);
+    const uint64_t total = tbl.catalan();
+    nthreads = std::clamp<size_t>(nthreads, 1, total);
+
+    std::vector<F> fs(nthreads, f);
+    auto walk = [&](size_t t) {
+        uint64_t lo = total * t / nthreads;
+        uint64_t hi = total * (t + 1) / nthreads;
+        dyck_word w = tbl.unrank(lo);
+        for (uint64_t r = lo; r < hi; ++r) {
+            fs[t](r, w);
+            if (r + 1 < total) {
+                w = next_dyck(w);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < nthreads; ++t) {
+        threads.emplace_back(walk, t);
+    }
+    walk(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+    return fs;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifdef TESTING
+#include <numeric>
+
+#include "doctest.h"
+#include "exact.hpp"
+
+TEST_CASE("cut_and_splice_word")
+{
+    std::mt19937 gen{};
+    for (size_t n : {1, 3, 8, 20}) {
+        for (int i = 0; i < 50; ++i) {
+            symbols s(n);
+            std::ranges::shuffle(s, gen);
+            uint64_t w = to_word(s);
+            s.cut_and_splice();
+            CHECK_EQ(cut_and_splice_word(w, 2 * n + 1), to_word(s));
+        }
+    }
+}
+
+TEST_CASE("exact_distribution")
+{
+    SUBCASE("unbiased scramble is exactly uniform")
+    {
+        for (size_t n = 1; n <= 6; ++n) {
+            auto dist = exact_distribution(n, false, 2);
+            CHECK_EQ(dist.size(), catalan(n));
+            CHECK_EQ(std::accumulate(dist.begin(), dist.end(), 0.0),
+                     doctest::Approx(1.0));
+            CHECK_LT(tv_distance(dist), 1e-12);
+        }
+    }
+
+    SUBCASE("biased scramble is not")
+    {
+        auto dist = exact_distribution(4, true, 2);
+        CHECK_EQ(std::accumulate(dist.begin(), dist.end(), 0.0),
+                 doctest::Approx(1.0));
+        CHECK_GT(tv_distance(dist), 0.01);
+
+        // the n=4 biased non-convergence test has far more samples than it
+        // needs to notice the bias.
+        CHECK_LT(detection_samples(dist), 1 << 16);
+    }
+
+    SUBCASE("thread count does not change the result")
+    {
+        auto one = exact_distribution(5, true, 1);
+        auto many = exact_distribution(5, true, 4);
+        REQUIRE_EQ(one.size(), many.size());
+        for (size_t i = 0; i < one.size(); ++i) {
+            CHECK_EQ(one[i], doctest::Approx(many[i]));
+        }
+    }
+}
+
+#endif
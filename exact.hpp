@@ -0,0 +1,161 @@
+#ifndef EXACT_HPP
+#define EXACT_HPP
+
+#include <cmath>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "enumerate.hpp"
+
+// exact analysis of `symbols::scramble` followed by `cut_and_splice`.
+//
+// sequences of 2n+1 symbols are packed into words the same way as
+// `dyck_word` (first symbol in the most significant bit).
+
+// probability that the scramble swaps index `i` with index `k`.
+//
+// mirrors the distributions used in `symbols::scramble`.
+inline double swap_probability(size_t i, size_t k, bool bias)
+{
+    if (!bias) {
+        return 1.0 / double(i + 1);
+    }
+    // binomial(i, 0.5) pmf, in logs so it doesn't overflow
+    return std::exp(std::lgamma(i + 1.0) - std::lgamma(k + 1.0) -
+                    std::lgamma(i - k + 1.0) - double(i) * std::log(2.0));
+}
+
+// `symbols::cut_and_splice` on a packed sequence of `len` symbols.
+inline dyck_word cut_and_splice_word(uint64_t w, size_t len)
+{
+    // find the first lowest valley
+    int sum = 0, low = 1;
+    size_t v = 0;
+    for (size_t i = 0; i < len; ++i) {
+        sum += (w >> (len - 1 - i)) & 1 ? 1 : -1;
+        if (sum < low) {
+            low = sum;
+            v = i;
+        }
+    }
+    // [P2:P1'], dropping the symbol at v
+    size_t tail = len - 1 - v;
+    uint64_t p2 = w & ((1ull << tail) - 1);
+    uint64_t p1 = w >> (tail + 1);
+    return (p2 << v) | p1;
+}
+
+// returns the exact probability of every balanced list of size `n`, indexed
+// by `catalan_table::rank`, that `scramble(bias)` then `cut_and_splice` from
+// `symbols(n)` produces.
+//
+// walks every swap choice of the Fisher-Yates scramble, memoizing the
+// probability of each distinct intermediate sequence so each level only has
+// as many states as there are arrangements (at most binom(2n+1, n)). each
+// level is split across `nthreads` threads.
+//
+// practical up to around n = 10.
+inline std::vector<double>
+exact_distribution(size_t n, bool bias,
+                   size_t nthreads = std::thread::hardware_concurrency())
+{
+    if (2 * n + 1 > 63) {
+        throw std::runtime_error("n too large for exact distribution");
+    }
+    nthreads = std::max<size_t>(nthreads, 1);
+    const size_t len = 2 * n + 1;
+    using level = std::unordered_map<uint64_t, double>;
+
+    // n 1s followed by n+1 -1s
+    level states{{((1ull << n) - 1) << (n + 1), 1.0}};
+
+    for (size_t i = len - 1; i > 0; --i) {
+        std::vector<std::pair<uint64_t, double>> cur(states.begin(),
+                                                     states.end());
+        std::vector<double> pk(i + 1);
+        for (size_t k = 0; k <= i; ++k) {
+            pk[k] = swap_probability(i, k, bias);
+        }
+        std::vector<level> parts(nthreads);
+        auto step = [&](size_t t) {
+            level& next = parts[t];
+            size_t lo = cur.size() * t / nthreads;
+            size_t hi = cur.size() * (t + 1) / nthreads;
+            const size_t bi = len - 1 - i;
+            for (size_t s = lo; s < hi; ++s) {
+                auto [w, p] = cur[s];
+                for (size_t k = 0; k <= i; ++k) {
+                    const size_t bk = len - 1 - k;
+                    uint64_t swapped = w;
+                    if (((w >> bi) ^ (w >> bk)) & 1) {
+                        swapped ^= (1ull << bi) | (1ull << bk);
+                    }
+                    next[swapped] += p * pk[k];
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < nthreads; ++t) {
+            threads.emplace_back(step, t);
+        }
+        step(0);
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        states = std::move(parts[0]);
+        for (size_t t = 1; t < nthreads; ++t) {
+            for (const auto& [w, p] : parts[t]) {
+                states[w] += p;
+            }
+        }
+    }
+
+    const catalan_table tbl(n);
+    std::vector<double> dist(tbl.catalan(), 0.0);
+    for (const auto& [w, p] : states) {
+        dist[tbl.rank(cut_and_splice_word(w, len))] += p;
+    }
+    return dist;
+}
+
+// total variation distance of `dist` from the uniform distribution.
+inline double tv_distance(const std::vector<double>& dist)
+{
+    double u = 1.0 / dist.size();
+    double d = 0.0;
+    for (const auto& p : dist) {
+        d += std::abs(p - u);
+    }
+    return d / 2;
+}
+
+// chi-square effect size of `dist` against uniform:
+// sum((p - u)^2 / u).
+//
+// N samples give a chi-square statistic with noncentrality N times this.
+inline double chi_square_effect(const std::vector<double>& dist)
+{
+    double u = 1.0 / dist.size();
+    double e = 0.0;
+    for (const auto& p : dist) {
+        e += (p - u) * (p - u) / u;
+    }
+    return e;
+}
+
+// approximate number of samples a chi-square uniformity test needs to tell
+// `dist` apart from uniform, given the z-scores of the significance level and
+// the power. (defaults: 1% significance, 90% power)
+//
+// uses the normal approximation to the noncentral chi-square, which is good
+// when there are many lists.
+inline double detection_samples(const std::vector<double>& dist,
+                                double z_alpha = 2.326, double z_beta = 1.282)
+{
+    double df = dist.size() - 1.0;
+    return (z_alpha + z_beta) * std::sqrt(2 * df) / chi_square_effect(dist);
+}
+
+#endif
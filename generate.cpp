@@ -0,0 +1,160 @@
+#ifdef TESTING
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "doctest.h"
+#include "generate.hpp"
+#include "validate.hpp"
+
+TEST_CASE("generate")
+{
+    auto dir = std::filesystem::temp_directory_path();
+    std::string path = dir / "lab4test_generate";
+
+    auto run = [&](const generate_options& opt) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        REQUIRE(fd >= 0);
+        auto stats = generate(fd, opt);
+        ::close(fd);
+        std::ifstream f(path, std::ios::binary);
+        std::ostringstream os;
+        os << f.rdbuf();
+        return std::pair{stats, os.str()};
+    };
+
+    SUBCASE("text is what operator<< prints")
+    {
+        for (const auto& s : views::balanced(7, 1) | std::views::take(5)) {
+            std::vector<char> out;
+            detail::append_text(out, s);
+            std::ostringstream os;
+            os << s << '\n';
+            CHECK_EQ(std::string(out.begin(), out.end()), os.str());
+        }
+    }
+
+    SUBCASE("writes exactly `count` balanced lists")
+    {
+        // several chunks, the last one partial
+        generate_options opt{500, 3 * chunk_lists(500) + 17, 5, false, 3};
+        auto [stats, text] = run(opt);
+        CHECK_EQ(stats.lists, opt.count);
+        CHECK_EQ(stats.bytes, text.size());
+        CHECK_FALSE(stats.closed);
+
+        input_buffer in(path);
+        auto totals = validate_input(in, [](size_t, size_t len, bool) {
+            CHECK_EQ(len, 1000);
+        });
+        CHECK_EQ(totals.records, opt.count);
+        CHECK_EQ(totals.balanced, opt.count);
+    }
+
+    SUBCASE("the same seed gives the same output on any number of threads")
+    {
+        generate_options opt{100, 2 * chunk_lists(100) + 3, 11, true, 1};
+        auto one = run(opt).second;
+        opt.threads = 4;
+        auto four = run(opt).second;
+        CHECK_EQ(one, four);
+        CHECK_EQ(one.size(),
+                 stream_header::SIZE + opt.count * ((200 + 7) / 8));
+
+        // the first chunk is the seeded view
+        input_buffer in(path);
+        stream_reader lists(in);
+        CHECK_EQ(lists.header().seed, 11);
+        std::vector<int8_t> s;
+        for (const auto& want :
+             views::balanced(100, chunk_seed(11, 0)) | std::views::take(10)) {
+            REQUIRE(lists.next(s));
+            CHECK(std::ranges::equal(s, want));
+        }
+    }
+
+    SUBCASE("the engine goes in the header")
+    {
+        generate_options opt{64, chunk_lists(64) + 5, 3, true, 2};
+        opt.eng = engine::xoshiro256x8;
+        auto fast = run(opt).second;
+        opt.eng = engine::mt19937;
+        CHECK_NE(run(opt).second, fast);
+        opt.eng = engine::xoshiro256x8;
+        CHECK_EQ(run(opt).second, fast);
+
+        input_buffer in(path);
+        stream_reader lists(in);
+        CHECK_EQ(lists.header().eng, engine::xoshiro256x8);
+        std::vector<int8_t> s;
+        for (const auto& want : views::balanced(64, chunk_seed(3, 0),
+                                                engine::xoshiro256x8) |
+                                    std::views::take(10)) {
+            REQUIRE(lists.next(s));
+            CHECK(std::ranges::equal(s, want));
+        }
+        input_buffer again(path);
+        CHECK_EQ(validate_input(again, [](size_t, size_t, bool) {}).balanced,
+                 opt.count);
+    }
+
+    SUBCASE("spliced output is the same as written output")
+    {
+        generate_options opt{30, 4 * chunk_lists(30) + 5, 2, true, 2};
+        auto written = run(opt).second;
+
+        // a small pipe so buffers have to wait for the reader to come free
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        ::fcntl(fds[1], F_SETPIPE_SZ, 1 << 14);
+        std::string spliced;
+        std::thread reader([&] {
+            char buf[4096];
+            ssize_t r;
+            while ((r = ::read(fds[0], buf, sizeof(buf))) > 0) {
+                spliced.append(buf, r);
+            }
+        });
+        opt.splice = true;
+        auto stats = generate(fds[1], opt);
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+        CHECK_EQ(stats.lists, opt.count);
+        CHECK(spliced == written);
+
+        // not a pipe
+        int fd = ::open(path.c_str(), O_WRONLY | O_TRUNC);
+        CHECK_THROWS_AS(generate(fd, opt), std::runtime_error);
+        ::close(fd);
+    }
+
+    SUBCASE("a write error is thrown, not fatal")
+    {
+        // every write to /dev/full fails with ENOSPC
+        int fd = ::open("/dev/full", O_WRONLY);
+        REQUIRE(fd >= 0);
+        generate_options opt{8, 20 * chunk_lists(8), 1, false, 3};
+        CHECK_THROWS_AS(generate(fd, opt), std::runtime_error);
+        ::close(fd);
+    }
+
+    SUBCASE("stops when the reader goes away")
+    {
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        ::close(fds[0]);
+        generate_options opt{10, stream_header::UNBOUNDED, 1, false, 2};
+        auto stats = generate(fds[1], opt);
+        ::close(fds[1]);
+        CHECK(stats.closed);
+    }
+
+    std::filesystem::remove(path);
+}
+
+#endif
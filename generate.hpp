@@ -0,0 +1,343 @@
+#ifndef GENERATE_HPP
+#define GENERATE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <ranges>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "outofcore.hpp"
+#include "stream.hpp"
+#include "views.hpp"
+
+// streams random balanced lists to a file descriptor as fast as it will take
+// them.
+//
+// the output is cut into chunks of `chunk_lists(n)` lists. worker threads
+// each claim the next chunk, make its lists and format them into one of a
+// fixed ring of buffers, while the calling thread writes the buffers out in
+// chunk order. when the reader falls behind the writer blocks in write(2),
+// the ring fills up and the workers wait for it, so memory stays bounded
+// however long it runs.
+//
+// chunk k is made by `views::balanced(n, chunk_seed(seed, k), eng)`, so the
+// output only depends on the seed and engine, never on the number of threads.
+//
+// with `splice`, binary output to a pipe is handed to the kernel with
+// vmsplice(2) rather than copied in by write(2). the pipe then refers to the
+// buffer's pages until the reader gets to them, so a buffer is only given
+// back to the workers once at least a pipe's worth of later output has gone
+// in after it, which pushes it out of the pipe. the ring is made big enough
+// that this never waits on itself.
+
+struct generate_options {
+    size_t n = 4;
+    uint64_t count = stream_header::UNBOUNDED;
+    uint64_t seed = 0;
+    bool binary = false;
+    size_t threads = std::thread::hardware_concurrency();
+    bool splice = false; // binary output to a pipe only
+    engine eng = engine::mt19937;
+};
+
+struct generate_stats {
+    uint64_t lists = 0;
+    uint64_t bytes = 0;
+    double seconds = 0;
+    // total time workers waited for a free buffer: the reader is too slow
+    double worker_stall = 0;
+    // time the writer waited for a full buffer: the workers are too slow
+    double writer_stall = 0;
+    // true if the reader went away before everything was written
+    bool closed = false;
+};
+
+// lists per chunk, about a million symbols
+inline size_t chunk_lists(size_t n)
+{
+    return std::max<size_t>(1, (1 << 20) / (2 * n + 1));
+}
+
+// splitmix64 of the chunk index, so neighbouring chunks get unrelated seeds
+inline uint64_t chunk_seed(uint64_t seed, uint64_t k)
+{
+    uint64_t z = seed + (k + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+namespace detail {
+
+// allocates whole pages, so vmsplice can hand them to a pipe without copying
+template<class T>
+struct page_allocator {
+    using value_type = T;
+
+    page_allocator() = default;
+    template<class U>
+    page_allocator(const page_allocator<U>&)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), page()));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p, page()); }
+
+    bool operator==(const page_allocator&) const = default;
+
+private:
+    static std::align_val_t page()
+    {
+        return std::align_val_t(::sysconf(_SC_PAGESIZE));
+    }
+};
+
+using output_buffer = std::vector<char, page_allocator<char>>;
+
+// appends `s` to `out` exactly as `operator<<` prints it, and a newline
+template<class V>
+void append_text(V& out, std::span<const int8_t> s)
+{
+    out.push_back('{');
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == -1) {
+            out.push_back('-');
+        }
+        out.push_back('1');
+        if (i + 1 < s.size()) {
+            out.push_back(',');
+            out.push_back(' ');
+        }
+    }
+    out.push_back('}');
+    out.push_back('\n');
+}
+
+// writes all of `buf`, false if the reader has closed the pipe.
+//
+// with `splice` the pages are given to the pipe `fd` by reference and must
+// not be changed until the reader has read them.
+inline bool write_or_closed(int fd, std::span<const char> buf,
+                            bool splice = false)
+{
+    size_t off = 0;
+    while (off < buf.size()) {
+        ssize_t w;
+        if (splice) {
+            iovec iov{const_cast<char*>(buf.data() + off), buf.size() - off};
+            w = ::vmsplice(fd, &iov, 1, 0);
+        }
+        else {
+            w = ::write(fd, buf.data() + off, buf.size() - off);
+        }
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EPIPE) {
+                return false;
+            }
+            throw sys_error(splice ? "vmsplice" : "write");
+        }
+        off += w;
+    }
+    return true;
+}
+
+// bytes `fd` can hold, if it is a pipe. 0 if it isn't.
+inline size_t pipe_size(int fd)
+{
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || !S_ISFIFO(st.st_mode)) {
+        return 0;
+    }
+    int size = ::fcntl(fd, F_GETPIPE_SZ);
+    if (size < 0) {
+        throw sys_error("F_GETPIPE_SZ");
+    }
+    return size;
+}
+
+} // namespace detail
+
+// writes `opt.count` lists (or until the reader closes `fd`) as text, or as
+// a binary stream (stream.hpp) if `opt.binary`.
+inline generate_stats generate(int fd, const generate_options& opt)
+{
+    using clock = std::chrono::steady_clock;
+    using secs = std::chrono::duration<double>;
+
+    if (opt.n == 0) {
+        throw std::runtime_error("n must be at least 1 to generate");
+    }
+    const size_t pipe = opt.splice ? detail::pipe_size(fd) : 0;
+    if (opt.splice && (!opt.binary || pipe == 0)) {
+        throw std::runtime_error("splice needs binary output to a pipe");
+    }
+    // a closed pipe should end the run, not the process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const size_t per_chunk = chunk_lists(opt.n);
+    const uint64_t nchunks =
+        opt.count == stream_header::UNBOUNDED
+            ? opt.count
+            : (opt.count + per_chunk - 1) / per_chunk;
+    const size_t nthreads = std::max<size_t>(opt.threads, 1);
+    // enough that the chunks after any one fill the pipe
+    const size_t chunk_bytes = per_chunk * ((2 * opt.n + 7) / 8);
+    const size_t nslots = std::max<size_t>(
+        {2 * nthreads, 4, (pipe + chunk_bytes - 1) / chunk_bytes + 2});
+    // bytes in the whole binary stream, if it ends. the end is written with
+    // write(2) so nothing is still in the pipe by reference on return.
+    const uint64_t total_bytes =
+        opt.count == stream_header::UNBOUNDED
+            ? opt.count
+            : stream_header::SIZE + opt.count * ((2 * opt.n + 7) / 8);
+
+    // slot k % nslots holds chunk k. `turn` is the chunk it may hold next.
+    // `held_until` is how far the output must get before the pipe lets go of
+    // a spliced buffer.
+    struct slot {
+        detail::output_buffer data;
+        uint64_t turn = 0;
+        bool ready = false;
+        uint64_t held_until = 0;
+    };
+    std::vector<slot> ring(nslots);
+    for (size_t i = 0; i < nslots; ++i) {
+        ring[i].turn = i;
+    }
+    std::mutex m;
+    std::condition_variable freed, filled;
+    std::atomic<uint64_t> next{0};
+    bool stop = false;
+    generate_stats stats;
+    std::vector<double> stalls(nthreads, 0.0);
+
+    auto work = [&](size_t t) {
+        detail::output_buffer buf;
+        for (;;) {
+            uint64_t k = next.fetch_add(1);
+            if (k >= nchunks) {
+                return;
+            }
+            size_t lists = std::min<uint64_t>(
+                per_chunk, opt.count == stream_header::UNBOUNDED
+                               ? per_chunk
+                               : opt.count - k * per_chunk);
+
+            buf.clear();
+            auto chunk =
+                views::balanced(opt.n, chunk_seed(opt.seed, k), opt.eng) |
+                std::views::take(lists);
+            for (const auto& s : chunk) {
+                if (opt.binary) {
+                    size_t at = buf.size();
+                    buf.resize(at + (s.size() + 7) / 8);
+                    detail::pack(s.data(), s.size(),
+                                 reinterpret_cast<uint8_t*>(buf.data() + at));
+                }
+                else {
+                    detail::append_text(buf, s);
+                }
+            }
+
+            slot& sl = ring[k % nslots];
+            auto start = clock::now();
+            std::unique_lock lock(m);
+            freed.wait(lock, [&] {
+                return stop || (sl.turn == k && !sl.ready &&
+                                sl.held_until <= stats.bytes);
+            });
+            stalls[t] += secs(clock::now() - start).count();
+            if (stop) {
+                return;
+            }
+            std::swap(sl.data, buf);
+            sl.ready = true;
+            filled.notify_one();
+        }
+    };
+
+    auto start = clock::now();
+    if (opt.binary) {
+        stream_header h{opt.n, opt.count, opt.seed, opt.eng};
+        char head[stream_header::SIZE];
+        encode_header(h, reinterpret_cast<uint8_t*>(head));
+        stats.closed = !detail::write_or_closed(fd, head);
+        stats.bytes += sizeof(head);
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < nthreads; ++t) {
+        workers.emplace_back(work, t);
+    }
+    // a write error is thrown on only once the workers have stopped
+    std::exception_ptr failed;
+    try {
+        for (uint64_t k = 0; k < nchunks && !stats.closed; ++k) {
+            slot& sl = ring[k % nslots];
+            auto wait = clock::now();
+            std::unique_lock lock(m);
+            filled.wait(lock, [&] { return sl.ready; });
+            stats.writer_stall += secs(clock::now() - wait).count();
+            detail::output_buffer data = std::move(sl.data);
+            uint64_t bytes = stats.bytes;
+            lock.unlock();
+
+            bool splice =
+                opt.splice && total_bytes - bytes - data.size() >= pipe;
+            stats.closed = !detail::write_or_closed(fd, data, splice);
+
+            lock.lock();
+            // hand the buffer back so its memory is reused
+            stats.bytes += data.size();
+            stats.lists +=
+                std::min<uint64_t>(per_chunk, opt.count - k * per_chunk);
+            sl.held_until = splice ? stats.bytes + pipe : 0;
+            sl.data = std::move(data);
+            sl.ready = false;
+            sl.turn = k + nslots;
+            freed.notify_all();
+        }
+    }
+    catch (...) {
+        failed = std::current_exception();
+    }
+    {
+        std::lock_guard lock(m);
+        stop = true;
+    }
+    freed.notify_all();
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (failed) {
+        std::rethrow_exception(failed);
+    }
+
+    stats.seconds = secs(clock::now() - start).count();
+    for (const auto& s : stalls) {
+        stats.worker_stall += s;
+    }
+    return stats;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifdef TESTING
+
+#include <stdexcept>
+#include <vector>
+
+#include "generator.hpp"
+
+#include "doctest.h"
+
+namespace {
+
+generator<int> count_to(int n)
+{
+    for (int i = 0; i < n; ++i) {
+        co_yield i;
+    }
+}
+
+generator<int> throws_after(int n)
+{
+    for (int i = 0; i < n; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("done");
+}
+
+} // namespace
+
+TEST_CASE("generator")
+{
+    static_assert(std::ranges::input_range<generator<int>>);
+    static_assert(std::ranges::view<generator<int>>);
+
+    SUBCASE("yields every value in order")
+    {
+        std::vector<int> got;
+        for (int i : count_to(5)) {
+            got.push_back(i);
+        }
+        CHECK_EQ(got, std::vector<int>{0, 1, 2, 3, 4});
+    }
+
+    SUBCASE("empty")
+    {
+        auto g = count_to(0);
+        CHECK(g.begin() == g.end());
+    }
+
+    SUBCASE("composes with views")
+    {
+        std::vector<int> got;
+        for (int i : count_to(100) |
+                         std::views::filter([](int i) { return i % 3 == 0; }) |
+                         std::views::take(4)) {
+            got.push_back(i);
+        }
+        CHECK_EQ(got, std::vector<int>{0, 3, 6, 9});
+    }
+
+    SUBCASE("passes on exceptions")
+    {
+        int seen = 0;
+        auto g = throws_after(3);
+        CHECK_THROWS_AS(
+            [&] {
+                for (int i : g) {
+                    seen += i;
+                }
+            }(),
+            std::runtime_error);
+        CHECK_EQ(seen, 3);
+    }
+}
+
+#endif
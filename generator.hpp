@@ -0,0 +1,109 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+
+// a minimal coroutine generator, until std::generator is available.
+//
+// the coroutine `co_yield`s lvalues of type T and the generator is an input
+// view over them. nothing is copied: each element is a reference to the
+// yielded object, valid until the iterator is next incremented, so a
+// coroutine can yield the same buffer over and over.
+template<class T>
+class generator : public std::ranges::view_interface<generator<T>> {
+public:
+    struct promise_type {
+        const T* value = nullptr;
+        std::exception_ptr error;
+
+        generator get_return_object()
+        {
+            return generator(handle::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const T& v) noexcept
+        {
+            value = std::addressof(v);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        // generators only yield
+        void await_transform() = delete;
+    };
+
+    using handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        const T& operator*() const { return *h.promise().value; }
+
+        iterator& operator++()
+        {
+            h.resume();
+            rethrow(h);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return h.done(); }
+
+    private:
+        friend generator;
+        explicit iterator(handle h) : h(h) {}
+
+        handle h;
+    };
+
+    generator() = default;
+    generator(generator&& o) noexcept : h(std::exchange(o.h, {})) {}
+    generator& operator=(generator&& o) noexcept
+    {
+        std::swap(h, o.h);
+        return *this;
+    }
+    ~generator()
+    {
+        if (h) {
+            h.destroy();
+        }
+    }
+
+    // runs the coroutine up to its first `co_yield`. only call once.
+    iterator begin()
+    {
+        h.resume();
+        rethrow(h);
+        return iterator(h);
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit generator(handle h) : h(h) {}
+
+    // passes on whatever the coroutine threw
+    static void rethrow(handle h)
+    {
+        if (h.promise().error) {
+            std::rethrow_exception(std::exchange(h.promise().error, {}));
+        }
+    }
+
+    handle h;
+};
+
+#endif
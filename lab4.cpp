@@ -1,7 +1,12 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <csignal>
+#include <exception>
 #include <iostream>
 #include <iterator>
+#include <mutex>
 #include <numeric>
 #include <random>
 #include <ranges>
@@ -9,7 +14,22 @@
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include "archive.hpp"
 #include "balance.hpp"
+#include "collision.hpp"
+#include "enumerate.hpp"
+#include "exact.hpp"
+#include "generate.hpp"
+#include "memory.hpp"
+#include "outofcore.hpp"
+#include "properties.hpp"
+#include "server.hpp"
+#include "shmring.hpp"
+#include "table.hpp"
+#include "stream.hpp"
+#include "validate.hpp"
+#include "views.hpp"
+#include "xoshiro.hpp"
 
 template<std::ranges::input_range R>
     requires std::integral<std::ranges::range_value_t<R>> ||
@@ -17,12 +37,12 @@ template<std::ranges::input_range R>
 static double variance(const R& lst)
 {
     double mean = std::accumulate(lst.begin(), lst.end(), 0.0) / lst.size();
-    std::vector<double> sqdiffs;
-    std::ranges::transform(lst, std::back_inserter(sqdiffs), [=](auto& n) {
-        return std::pow(double(n) - mean, 2);
-    });
-    double variance = std::accumulate(sqdiffs.begin(), sqdiffs.end(), 0.0) /
-                      (sqdiffs.size() - 1);
+    // summed as they go rather than kept
+    double sqdiffs = std::accumulate(
+        lst.begin(), lst.end(), 0.0, [=](double sum, const auto& n) {
+            return sum + std::pow(double(n) - mean, 2);
+        });
+    double variance = sqdiffs / (lst.size() - 1);
     return variance;
 }
 
@@ -41,41 +61,68 @@ static double stddev(const R& lst)
     return std::sqrt(variance(lst));
 }
 
-// generates `ns` symbols of size `2n+1`, scrambles them, balances them, and
-// populates the `table` with the unique balanced lists and their respective
-// number of occurences.
+// the `ns` lists of size `2n+1` an iteration works on, all on one arena,
+// and the engine they're scrambled with.
+//
+// they are kept from one iteration to the next and refilled in place, so
+// once made, iterations don't go back to the heap.
+struct batch {
+    batch(size_t n, size_t ns)
+        : arena((ns + 1) * (sizeof(symbols) + 2 * n + 1)), init(n, &arena),
+          syms(symbols::generate_n(n, ns, &arena)), rng(seed())
+    {
+    }
+
+#ifdef TESTING
+    // a fixed seed, as for `symbols::rd`, to get reproducible tests
+    static uint64_t seed() { return 0; }
+#else
+    static uint64_t seed()
+    {
+        return (uint64_t(std::random_device{}()) << 32) |
+               std::random_device{}();
+    }
+#endif
+
+    std::pmr::monotonic_buffer_resource arena;
+    const symbols init;
+    std::pmr::vector<symbols> syms;
+    // fills whole blocks of words for `scramble_batch` at a time
+    xoshiro256x8 rng;
+};
+
+// refills the `ns` symbols of `b` with `n` 1s and `n+1` -1s, scrambles them,
+// balances them, and populates the `table` with the unique balanced lists
+// and their respective number of occurences.
 //
 // biases the scramble function if `bias == true` (for testing)
 //
 // returns the standard deviation of the frequencies of each unique balanced
 // list and the total number of symbols tested.
-static std::pair<double, int>
-run_iteration(std::unordered_map<symbols, int>& table, size_t n, size_t ns,
-              bool bias = false)
+static std::pair<double, int> run_iteration(freq_table& table, batch& b,
+                                            bool bias = false)
 {
-    std::vector<symbols> syms = symbols::generate_n(n, ns);
-    std::ranges::for_each(syms, [=](auto& s) {
-        s.scramble(bias);
-        s.cut_and_splice();
-    });
-    std::ranges::for_each(syms, [&](auto& s) {
-        auto [kv, ins] = table.insert({s, 1});
-        if (!ins) {
-            auto& [_, v] = *kv;
-            v += 1;
+    for (auto& s : b.syms) {
+        s.assign(b.init.begin(), b.init.end());
+    }
+    if (bias) {
+        for (auto& s : b.syms) {
+            s.scramble(b.rng, bias);
         }
-    });
-    auto vals = std::views::values(table);
-    int nsyms = std::accumulate(vals.begin(), vals.end(), 0);
-
-    std::vector<double> freqs;
-    std::ranges::transform(vals, std::back_inserter(freqs),
-                           [=](auto& v) { return v / double(nsyms); });
+    }
+    else {
+        symbols::scramble_batch(b.syms, b.rng);
+    }
+    for (auto& s : b.syms) {
+        s.cut_and_splice();
+        table.add(s);
+    }
 
-    return {stddev(freqs), nsyms};
+    // walks the counts-of-counts rather than every list
+    return {table.freq_stddev(), table.total()};
 }
 
-// calls `run_iteration(table, n, ns)` until the distribution of unique balanced
+// calls `run_iteration` on batches of `ns` lists until the distribution of unique balanced
 // lists has been shown to be uniform.
 //
 // uniformity determined by `stddev(freq_of_unique_lists) < (1/n_unique)*eps`
@@ -85,15 +132,16 @@ run_iteration(std::unordered_map<symbols, int>& table, size_t n, size_t ns,
 //
 // **NOTE**: n > 10 has extremely long runtime and likely will not terminate
 static std::pair<double, int>
-run_to_convergence(std::unordered_map<symbols, int>& table, size_t n, size_t ns,
-                   double eps, size_t max_iters, bool bias = false)
+run_to_convergence(freq_table& table, size_t n, size_t ns, double eps,
+                   size_t max_iters, bool bias = false)
 {
     double sdev;
     int nsyms;
     size_t iters = 0;
+    batch b(n, ns);
 
     do {
-        std::tie(sdev, nsyms) = run_iteration(table, n, ns, bias);
+        std::tie(sdev, nsyms) = run_iteration(table, b, bias);
         ++iters;
         if (++iters > max_iters) {
             throw std::runtime_error("maximum iterations");
@@ -104,6 +152,36 @@ run_to_convergence(std::unordered_map<symbols, int>& table, size_t n, size_t ns,
     return {sdev, nsyms};
 }
 
+// calls `run_iteration` on batches of `ns` lists until the chao1 estimate of the number
+// of unique balanced lists is known to within `width` (relative width of its
+// 95% confidence interval).
+//
+// unlike `run_to_convergence` this does not need to see every list, so it
+// works when C_n is too large to wait for.
+//
+// throws an exception if the estimate is not tight within `max_iters`
+// iterations.
+static int run_to_estimate(freq_table& table, size_t n, size_t ns,
+                           double width, size_t max_iters)
+{
+    int nsyms;
+    size_t iters = 0;
+    double lo, hi;
+    batch b(n, ns);
+
+    do {
+        std::tie(std::ignore, nsyms) = run_iteration(table, b);
+        if (++iters > max_iters) {
+            throw std::runtime_error("maximum iterations");
+        }
+        std::tie(lo, hi) = table.chao1_ci();
+        std::cout << table.chao1() << "\t[" << lo << ", " << hi << "]"
+                  << std::endl;
+    } while ((hi - lo) / table.chao1() > width);
+
+    return nsyms;
+}
+
 #ifndef TESTING
 
 // mush 2 graphs together on the same lines for output
@@ -182,7 +260,7 @@ static std::string paste_graphs(std::vector<std::pair<symbols, int>>& lst,
 }
 
 // prints a random selection of `n` graphs from the given table of lists.
-static void print_selection(std::unordered_map<symbols, int>& table, int n)
+static void print_selection(const freq_table& table, int n)
 {
     std::vector<std::pair<symbols, int>> out;
     auto gen = std::mt19937{std::random_device{}()};
@@ -197,9 +275,515 @@ constexpr size_t DEFAULT_NSYMS = 1 << 16;
 constexpr size_t DEFAULT_N = 4;
 constexpr double DEFAULT_EPS = 0.1;
 constexpr size_t DEFAULT_MAXITERS = 1 << 10;
+constexpr double DEFAULT_CI_WIDTH = 0.01;
+constexpr size_t DEFAULT_COLLIDE_N = 20;
+constexpr size_t DEFAULT_COLLIDE_M = 1 << 20;
+constexpr size_t DEFAULT_PROPERTIES_N = 1000;
+constexpr size_t DEFAULT_PROPERTIES_M = 5000;
+constexpr size_t DEFAULT_DUMP_COUNT = 1 << 10;
+constexpr size_t DEFAULT_RING_CAPACITY = 1 << 16;
+
+// runs the birthday-collision uniformity test on `m` lists of size `n`.
+static int collide_main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? std::stoul(argv[1]) : DEFAULT_COLLIDE_N;
+    size_t m = argc > 2 ? std::stoul(argv[2]) : DEFAULT_COLLIDE_M;
+
+    auto r = birthday_test(n, m);
+    std::cout << "collisions for (n=" << n << ", m=" << m << "):\n";
+    std::cout << "colliding pairs\t= " << r.collisions << std::endl;
+    std::cout << "expected pairs\t= " << r.expected << std::endl;
+    std::cout << "p-value\t\t= " << r.p_value << std::endl;
+    std::cout << (r.pass ? "PASS" : "FAIL") << std::endl;
+    return r.pass ? 0 : 1;
+}
+
+// compares path statistics of `m` sampled lists of size `n` against their
+// exact distributions.
+static int properties_main(int argc, char** argv)
+{
+    size_t n = DEFAULT_PROPERTIES_N;
+    size_t m = DEFAULT_PROPERTIES_M;
+    bool bias = false;
+    std::vector<size_t> pos;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--bias") {
+            bias = true;
+        }
+        else {
+            pos.push_back(std::stoul(argv[i]));
+        }
+    }
+    n = pos.size() > 0 ? pos[0] : n;
+    m = pos.size() > 1 ? pos[1] : m;
+
+    auto start = std::chrono::steady_clock::now();
+    auto tests = property_tests(n, m, bias);
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    bool pass = true;
+    std::cout << "properties for (n=" << n << ", m=" << m << "):\n";
+    for (const auto& t : tests) {
+        std::cout << t.name << "\t= " << t.statistic << " (p=" << t.p_value
+                  << ")" << std::endl;
+        pass = pass && t.p_value >= 0.001;
+    }
+    std::cout << "seconds\t\t= " << secs.count() << std::endl;
+    std::cout << (pass ? "PASS" : "FAIL") << std::endl;
+    return pass ? 0 : 1;
+}
+
+// balances the packed sequence file `in` into `out` without loading it.
+static int splice_main(int argc, char** argv)
+{
+    if (argc != 3) {
+        throw std::runtime_error("splice needs an input and output file");
+    }
+    size_t valley = splice_file(argv[1], argv[2]);
+    std::cout << "lowest valley\t= " << valley << std::endl;
+    return 0;
+}
+
+// checks every list in a file (or standard input) for a non-negative prefix
+// sum, printing one line per list unless `--quiet`, then the totals.
+static int validate_main(int argc, char** argv)
+{
+    std::string path = "-";
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--quiet") {
+            quiet = true;
+        }
+        else {
+            path = argv[i];
+        }
+    }
+
+    // one big buffer for the per-list lines rather than flushing each one
+    std::string lines;
+    auto start = std::chrono::steady_clock::now();
+    input_buffer in(path);
+    auto totals = validate_input(in, [&](size_t i, size_t len, bool ok) {
+        if (quiet) {
+            return;
+        }
+        lines += std::to_string(i);
+        lines += '\t';
+        lines += std::to_string(len);
+        lines += ok ? "\tbalanced\n" : "\tunbalanced\n";
+        if (lines.size() >= input_buffer::BLOCK) {
+            std::cout << lines;
+            lines.clear();
+        }
+    });
+    std::cout << lines;
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "records\t\t= " << totals.records << std::endl;
+    std::cout << "balanced\t= " << totals.balanced << std::endl;
+    std::cout << "unbalanced\t= " << totals.records - totals.balanced
+              << std::endl;
+    std::cout << "malformed\t= " << totals.malformed << std::endl;
+    std::cout << "MB/s\t\t= " << in.bytes() / secs.count() / 1e6
+              << std::endl;
+    return totals.balanced == totals.records ? 0 : 1;
+}
+
+// writes `count` random balanced lists of size `n` to standard output as a
+// binary stream. the same seed writes the same lists.
+static int dump_main(int argc, char** argv)
+{
+    stream_header h;
+    h.n = argc > 1 ? std::stoul(argv[1]) : DEFAULT_N;
+    h.count = argc > 2 ? std::stoull(argv[2]) : DEFAULT_DUMP_COUNT;
+    h.seed = argc > 3 ? std::stoull(argv[3])
+                      : (uint64_t(std::random_device{}()) << 32) |
+                            std::random_device{}();
+    if (::isatty(STDOUT_FILENO)) {
+        throw std::runtime_error("not writing binary to a terminal");
+    }
+
+    stream_writer out(STDOUT_FILENO, h);
+    for (const auto& s : views::balanced(h.n, h.seed) |
+                             std::views::take(h.count)) {
+        out.write(s);
+    }
+    out.flush();
+    std::cerr << "seed\t\t= " << h.seed << std::endl;
+    return 0;
+}
+
+// converts the binary stream `in` (or standard input) into a rank archive
+// `out`, which must have a count in its header.
+static int archive_main(int argc, char** argv)
+{
+    if (argc != 3) {
+        throw std::runtime_error("archive needs an input and output file");
+    }
+    input_buffer in(argv[1]);
+    stream_reader lists(in);
+    if (lists.header().count == stream_header::UNBOUNDED) {
+        throw std::runtime_error("archive needs a stream with a count");
+    }
+    int fd = ::open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw detail::sys_error(argv[2]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    archive_writer out(fd, lists.header());
+    std::vector<int8_t> s;
+    while (lists.next(s)) {
+        out.write(s);
+    }
+    if (lists.truncated()) {
+        throw std::runtime_error(std::string(argv[1]) + ": truncated");
+    }
+    out.finish();
+    ::close(fd);
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    const auto& h = lists.header();
+    size_t before = stream_header::SIZE + h.count * h.record_size();
+    size_t after = stream_header::SIZE + out.coder().encoded_size(h.count);
+    std::cout << "bits per list\t= " << out.coder().bits() << " (was "
+              << 8 * h.record_size() << ")" << std::endl;
+    std::cout << "stream bytes\t= " << before << std::endl;
+    std::cout << "archive bytes\t= " << after << std::endl;
+    std::cout << "lists/s\t\t= " << h.count / secs.count() << std::endl;
+    return 0;
+}
+
+// streams random balanced lists to standard output until `--count` have been
+// written or the reader goes away, reporting throughput on standard error.
+//
+// `--splice` is `--binary` with pages handed to the output pipe by vmsplice.
+static int generate_main(int argc, char** argv)
+{
+    generate_options opt;
+    opt.seed = (uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--binary") {
+            opt.binary = true;
+        }
+        else if (arg == "--splice") {
+            opt.binary = opt.splice = true;
+        }
+        else if (arg == "--count" && i + 1 < argc) {
+            opt.count = std::stoull(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = std::stoul(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            opt.seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--engine" && i + 1 < argc) {
+            opt.eng = engine_from_name(argv[++i]);
+        }
+        else {
+            opt.n = std::stoul(argv[i]);
+        }
+    }
+    if (opt.binary && ::isatty(STDOUT_FILENO)) {
+        throw std::runtime_error("not writing binary to a terminal");
+    }
+
+    auto stats = generate(STDOUT_FILENO, opt);
+    std::cerr << "seed\t\t= " << opt.seed << std::endl;
+    std::cerr << "engine\t\t= " << engine_name(opt.eng) << std::endl;
+    std::cerr << "lists\t\t= " << stats.lists << std::endl;
+    std::cerr << "seconds\t\t= " << stats.seconds << std::endl;
+    std::cerr << "lists/s\t\t= " << stats.lists / stats.seconds << std::endl;
+    std::cerr << "MB/s\t\t= " << stats.bytes / stats.seconds / 1e6 << std::endl;
+    std::cerr << "worker stall\t= " << stats.worker_stall << "s" << std::endl;
+    std::cerr << "writer stall\t= " << stats.writer_stall << "s" << std::endl;
+    return 0;
+}
+
+// set by SIGINT and SIGTERM to stop long running subcommands cleanly
+static volatile std::sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int) { interrupted = 1; }
+
+// publishes random balanced lists of size `n` into the shared memory ring
+// `name` until `--count` have been pushed or it is interrupted, then closes
+// it. consumers attach with `shm_ring::open(name)`.
+static int publish_main(int argc, char** argv)
+{
+    if (argc < 2) {
+        throw std::runtime_error("publish needs a ring name");
+    }
+    std::string name = argv[1];
+    size_t n = DEFAULT_N;
+    uint64_t count = stream_header::UNBOUNDED;
+    size_t capacity = DEFAULT_RING_CAPACITY;
+    size_t nthreads = std::thread::hardware_concurrency();
+    uint64_t seed = (uint64_t(std::random_device{}()) << 32) |
+                    std::random_device{}();
+    for (int i = 2; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            count = std::stoull(argv[++i]);
+        }
+        else if (arg == "--capacity" && i + 1 < argc) {
+            capacity = std::stoul(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            nthreads = std::max<size_t>(std::stoul(argv[++i]), 1);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        }
+        else {
+            n = std::stoul(argv[i]);
+        }
+    }
+
+    auto ring = shm_ring::create(name, n, capacity);
+    std::signal(SIGINT, on_interrupt);
+    std::signal(SIGTERM, on_interrupt);
+
+    std::atomic<uint64_t> claimed{0}, pushed{0};
+    // the first error in a worker, thrown on once they have all stopped
+    std::mutex failed_m;
+    std::exception_ptr failed;
+    std::atomic<bool> failing{false};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < nthreads; ++t) {
+        workers.emplace_back([&, t] {
+            try {
+                // each worker has its own ring handle for its packing buffer
+                auto mine = shm_ring::open(name);
+                for (const auto& s :
+                     views::balanced(n, chunk_seed(seed, t))) {
+                    if (claimed.fetch_add(1) >= count || !mine.push(s)) {
+                        return;
+                    }
+                    pushed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            catch (...) {
+                std::lock_guard lock(failed_m);
+                if (!failed) {
+                    failed = std::current_exception();
+                }
+                failing = true;
+            }
+        });
+    }
+    std::thread([&] {
+        while (!interrupted && !failing && claimed.load() < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (interrupted || failing) {
+            ring.close();
+        }
+    }).join();
+    for (auto& w : workers) {
+        w.join();
+    }
+    ring.close();
+    if (failed) {
+        std::rethrow_exception(failed);
+    }
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    std::cerr << "seed\t\t= " << seed << std::endl;
+    std::cerr << "lists\t\t= " << pushed << std::endl;
+    std::cerr << "lists/s\t\t= " << pushed / secs.count() << std::endl;
+    return 0;
+}
+
+// reads lists from the shared memory ring `name` until it is closed, or
+// `--count` have been read, checking each one.
+static int subscribe_main(int argc, char** argv)
+{
+    if (argc < 2) {
+        throw std::runtime_error("subscribe needs a ring name");
+    }
+    uint64_t count = stream_header::UNBOUNDED;
+    if (argc > 3 && std::string_view(argv[2]) == "--count") {
+        count = std::stoull(argv[3]);
+    }
+
+    auto ring = shm_ring::open(argv[1]);
+    std::vector<int8_t> s;
+    uint64_t records = 0, balanced = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (records < count && ring.pop(s)) {
+        ++records;
+        balanced += non_neg_prefix_sum(s);
+    }
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "records\t\t= " << records << std::endl;
+    std::cout << "balanced\t= " << balanced << std::endl;
+    std::cout << "lists/s\t\t= " << records / secs.count() << std::endl;
+    return balanced == records ? 0 : 1;
+}
+
+// answers requests for lists on the unix socket `path` until interrupted,
+// then reports how long they took
+static int serve_main(int argc, char** argv)
+{
+    if (argc < 2) {
+        throw std::runtime_error("serve needs a socket path");
+    }
+    server_options opt;
+    opt.seed = (uint64_t(std::random_device{}()) << 32) |
+               std::random_device{}();
+    for (int i = 2; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            opt.seed = std::stoull(argv[++i]);
+        }
+        else {
+            throw std::runtime_error("unknown serve option " +
+                                     std::string(arg));
+        }
+    }
+
+    list_server server(argv[1], opt);
+    std::signal(SIGINT, on_interrupt);
+    std::signal(SIGTERM, on_interrupt);
+    // a client going away mid answer shouldn't take the server with it
+    std::signal(SIGPIPE, SIG_IGN);
+    server.run([] { return interrupted != 0; });
+
+    latency_stats l = server.latency();
+    std::cerr << "seed\t\t= " << opt.seed << std::endl;
+    std::cerr << "requests\t= " << l.requests << std::endl;
+    std::cerr << "p50 (us)\t= " << l.p50 << std::endl;
+    std::cerr << "p99 (us)\t= " << l.p99 << std::endl;
+    return 0;
+}
+
+// asks the server on `path` for `count` lists of size `n` and prints them
+static int request_main(int argc, char** argv)
+{
+    if (argc < 2) {
+        throw std::runtime_error("request needs a socket path");
+    }
+    size_t n = argc > 2 ? std::stoul(argv[2]) : DEFAULT_N;
+    size_t count = argc > 3 ? std::stoul(argv[3]) : 1;
+    for (const auto& s : request_lists(argv[1], n, count)) {
+        std::cout << s << '\n';
+    }
+    return 0;
+}
 
 constexpr std::string_view USAGE =
-    "USAGE: ./lab4.out [n=4] [nsyms=65536] [maxiters=1024] [eps=0.1]\n";
+    "USAGE: ./lab4.out [n=4] [nsyms=65536] [maxiters=1024] [eps=0.1]\n"
+    "       ./lab4.out enumerate [n=4] [--count]\n"
+    "       ./lab4.out exact [n=4]\n"
+    "       ./lab4.out collide [n=20] [m=1048576]\n"
+    "       ./lab4.out properties [n=1000] [m=5000] [--bias]\n"
+    "       ./lab4.out splice in out\n"
+    "       ./lab4.out validate [file=-] [--quiet]\n"
+    "       ./lab4.out dump [n=4] [count=1024] [seed] > file\n"
+    "       ./lab4.out archive stream archive\n"
+    "       ./lab4.out generate [n=4] [--count k] [--binary] [--threads t]"
+    " [--seed s] [--splice]\n"
+    "                          [--engine mt19937|xoshiro256x8]\n"
+    "       ./lab4.out publish name [n=4] [--count k] [--capacity 65536]"
+    " [--threads t] [--seed s]\n"
+    "       ./lab4.out subscribe name [--count k]\n"
+    "       ./lab4.out serve socket [--seed s]\n"
+    "       ./lab4.out request socket [n=4] [count=1]\n";
+
+// lists every balanced list of size `n`, or with `--count` checks on all
+// cores that there are exactly C_n of them and that rank and unrank agree
+// for every one.
+static int enumerate_main(int argc, char** argv)
+{
+    size_t n = DEFAULT_N;
+    bool count = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--count") {
+            count = true;
+        }
+        else {
+            n = std::stoul(argv[i]);
+        }
+    }
+    if (n > MAX_WORD_N) {
+        throw std::runtime_error("n must be <= 32 to enumerate");
+    }
+
+    if (!count) {
+        for_each_dyck(
+            n,
+            [=](uint64_t, dyck_word w) {
+                std::cout << from_word(w, 2 * n) << '\n';
+            },
+            1);
+        return 0;
+    }
+
+    struct verify {
+        const catalan_table* tbl;
+        uint64_t count = 0;
+        uint64_t bad = 0;
+        void operator()(uint64_t rank, dyck_word w)
+        {
+            if (tbl->rank(w) != rank || tbl->unrank(rank) != w) {
+                ++bad;
+            }
+            ++count;
+        }
+    };
+
+    const catalan_table tbl(n);
+    auto start = std::chrono::steady_clock::now();
+    auto results = for_each_dyck(n, verify{&tbl});
+    std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    uint64_t total = 0, bad = 0;
+    for (const auto& r : results) {
+        total += r.count;
+        bad += r.bad;
+    }
+    std::cout << "enumeration for (n=" << n << "):\n";
+    std::cout << "unique lists\t= " << total << std::endl;
+    std::cout << "catalan number\t= " << catalan(n) << std::endl;
+    std::cout << "inconsistent\t= " << bad << std::endl;
+    std::cout << "threads\t\t= " << results.size() << std::endl;
+    std::cout << "seconds\t\t= " << secs.count() << std::endl;
+    return total == catalan(n) && bad == 0 ? 0 : 1;
+}
+
+// prints the exact distance from uniform of the unbiased and biased scramblers
+// for lists of size `n`, and how many samples a uniformity test needs to see
+// it.
+static int exact_main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? std::stoul(argv[1]) : DEFAULT_N;
+
+    std::cout << "exact distribution for (n=" << n << "):\n";
+    for (bool bias : {false, true}) {
+        auto dist = exact_distribution(n, bias);
+        auto [lo, hi] = std::ranges::minmax(dist);
+        std::cout << (bias ? "biased" : "unbiased") << ":\n";
+        std::cout << "unique lists\t= " << dist.size() << std::endl;
+        std::cout << "min prob.\t= " << lo << std::endl;
+        std::cout << "max prob.\t= " << hi << std::endl;
+        std::cout << "tv distance\t= " << tv_distance(dist) << std::endl;
+        std::cout << "chi2 effect\t= " << chi_square_effect(dist) << std::endl;
+        std::cout << "samples needed\t= " << detection_samples(dist)
+                  << std::endl;
+    }
+    return 0;
+}
 
 int main(int argc, char** argv)
 {
@@ -209,6 +793,45 @@ int main(int argc, char** argv)
     double eps = DEFAULT_EPS;
 
     try {
+        if (argc > 1 && std::string_view(argv[1]) == "enumerate") {
+            return enumerate_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "exact") {
+            return exact_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "collide") {
+            return collide_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "properties") {
+            return properties_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "splice") {
+            return splice_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "validate") {
+            return validate_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "dump") {
+            return dump_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "archive") {
+            return archive_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "generate") {
+            return generate_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "publish") {
+            return publish_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "subscribe") {
+            return subscribe_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "serve") {
+            return serve_main(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string_view(argv[1]) == "request") {
+            return request_main(argc - 1, argv + 1);
+        }
         if (argc > 1) {
             n = std::stoul(argv[1]);
         }
@@ -231,7 +854,10 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    std::unordered_map<symbols, int> table;
+    // everything the arenas and pools take from the heap goes through here
+    counting_resource heap;
+    std::pmr::set_default_resource(&heap);
+    freq_table table;
 
     std::cout << std::fixed;
     try {
@@ -244,28 +870,36 @@ int main(int argc, char** argv)
                       << ")"
                       << ":\n";
             std::cout << "unique lists\t= " << table.size() << std::endl;
+            std::cout << "catalan number\t= " << catalan(n) << std::endl;
             std::cout << "total samples\t= " << ns << std::endl;
             std::cout << "uniform freq.\t= " << (1.0 / table.size())
                       << std::endl;
             std::cout << "stddev(freqs)\t= " << sd << std::endl;
         }
         else { // n is too great for convergence in an acceptable timeframe
-            std::tie(std::ignore, ns) = run_iteration(table, n, nsyms);
-            size_t uniq = table.size();
-            std::tie(std::ignore, ns) = run_iteration(table, n, nsyms);
-            size_t nuniq = table.size();
-            while (uniq != nuniq) {
-                // find how many unique lists there are at least
-                std::tie(std::ignore, ns) = run_iteration(table, n, nsyms);
-                uniq = nuniq;
-                nuniq = table.size();
+            // so estimate how many unique lists there are instead
+            ns = run_to_estimate(table, n, nsyms, DEFAULT_CI_WIDTH, maxi);
+            auto [lo, hi] = table.chao1_ci();
+            std::cout << "estimate for ";
+            std::cout << "(n=" << n << ", nsyms=" << nsyms << ")"
+                      << ":\n";
+            std::cout << "est. lists\t= " << table.chao1() << " [" << lo
+                      << ", " << hi << "]" << std::endl;
+            if (n <= 36) {
+                std::cout << "catalan number\t= " << catalan(n) << std::endl;
             }
+            std::cout << "coverage\t= " << table.coverage() << std::endl;
         }
         std::cout << "result for ";
         std::cout << "(n=" << n << ", nsyms=" << nsyms << ")"
                   << ":\n";
         std::cout << "unique lists\t= " << table.size() << std::endl;
         std::cout << "total samples\t= " << ns << std::endl;
+        auto [lo, hi] = table.spread();
+        std::cout << "count spread\t= [" << lo << ", " << hi << "] over "
+                  << table.counts().size() << " distinct counts" << std::endl;
+        std::cout << "allocations\t= " << heap.allocations() << " ("
+                  << heap.peak() / (1 << 20) << " MiB peak)" << std::endl;
 
         // literally just because I was bored and wanted an excuse to do
         // more programming.
@@ -320,6 +954,48 @@ TEST_CASE("stddev")
     }
 }
 
+TEST_CASE("run_iteration allocations")
+{
+    SUBCASE("a batch takes an arena block or two")
+    {
+        counting_resource counter;
+        auto* old = std::pmr::set_default_resource(&counter);
+        {
+            batch b(6, 1 << 14);
+            CHECK_LE(counter.allocations(), 2);
+        }
+        std::pmr::set_default_resource(old);
+        CHECK_EQ(counter.in_use(), 0);
+    }
+
+    SUBCASE("none at all once warmed up")
+    {
+        // every one of the 14 lists of n=4 is seen in the first iteration,
+        // after which nothing new needs a key or a count
+        freq_table table;
+        batch b(4, 1 << 14);
+        run_iteration(table, b);
+        size_t before = heap_allocations();
+        for (int i = 0; i < 5; ++i) {
+            run_iteration(table, b);
+        }
+        CHECK_EQ(heap_allocations() - before, 0);
+        CHECK_EQ(table.total(), 6 << 14);
+        CHECK_EQ(table.size(), 14);
+    }
+}
+
+TEST_CASE("run_to_estimate")
+{
+    size_t n = 11;
+    freq_table table;
+    REQUIRE_NOTHROW(run_to_estimate(table, n, 1 << 16, 0.02, 20));
+    auto [lo, hi] = table.chao1_ci();
+    CHECK_LE(lo, catalan(n));
+    CHECK_GE(hi, catalan(n));
+    CHECK_LT(table.size(), catalan(n));
+}
+
 #ifdef FULLCHECK // these tests are slow so conditionally compile
 TEST_CASE("n=4")
 {
@@ -327,7 +1003,7 @@ TEST_CASE("n=4")
     size_t ns = 1 << 16;
     double eps = 0.1;
     size_t maxi = 50;
-    std::unordered_map<symbols, int> table;
+    freq_table table;
     SUBCASE("convergence")
     {
         // just returning demonstrates convergence.
@@ -345,7 +1021,7 @@ TEST_CASE("n=10")
     size_t ns = 1 << 16;
     double eps = 0.1;
     size_t maxi = 75;
-    std::unordered_map<symbols, int> table;
+    freq_table table;
     SUBCASE("convergence")
     {
         CHECK_NOTHROW(run_to_convergence(table, n, ns, eps, maxi));
@@ -0,0 +1,453 @@
+#include "libbalance.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <random>
+#include <variant>
+
+#include "xoshiro.hpp"
+
+// the C interface in libbalance.h.
+//
+// a list is made as `views::balanced` makes it: n 1s and n + 1 -1s, a
+// Fisher-Yates scramble, then the rotation that starts just after the lowest
+// valley, which drops that valley's -1. done in place in the caller's
+// buffer, packed or not, holding the one symbol that doesn't fit aside, so
+// nothing is allocated per list.
+
+namespace {
+
+// `std::seed_seq` for a 64 bit seed without its vector, so seeding doesn't
+// allocate either. gives exactly what `std::seed_seq{lo, hi}` does.
+struct seed_pair {
+    using result_type = uint32_t;
+
+    uint32_t v[2];
+
+    explicit seed_pair(uint64_t seed) : v{uint32_t(seed), uint32_t(seed >> 32)}
+    {
+    }
+
+    template<class It>
+    void generate(It b, It e) const
+    {
+        // [rand.util.seedseq] with s = 2
+        const size_t n = e - b;
+        const size_t s = 2;
+        if (n == 0) {
+            return;
+        }
+        std::fill(b, e, 0x8b8b8b8bu);
+        const size_t t = n >= 623 ? 11
+                         : n >= 68 ? 7
+                         : n >= 39 ? 5
+                         : n >= 7  ? 3
+                                   : (n - 1) / 2;
+        const size_t p = (n - t) / 2;
+        const size_t q = p + t;
+        const size_t m = std::max(s + 1, n);
+        auto T = [](uint32_t x) { return x ^ (x >> 27); };
+        for (size_t k = 0; k < m; ++k) {
+            uint32_t r1 = 1664525u * T(b[k % n] ^ b[(k + p) % n] ^
+                                       b[(k + n - 1) % n]);
+            uint32_t r2 = r1 + (k == 0    ? uint32_t(s)
+                                : k <= s ? uint32_t(k % n) + v[k - 1]
+                                         : uint32_t(k % n));
+            b[(k + p) % n] += r1;
+            b[(k + q) % n] += r2;
+            b[k % n] = r2;
+        }
+        for (size_t k = m; k < m + n; ++k) {
+            uint32_t r3 = 1566083941u * T(b[k % n] + b[(k + p) % n] +
+                                          b[(k + n - 1) % n]);
+            uint32_t r4 = r3 - uint32_t(k % n);
+            b[(k + p) % n] ^= r3;
+            b[(k + q) % n] ^= r4;
+            b[k % n] = r4;
+        }
+    }
+};
+
+// 2n + 1 symbols: the first 2n in the caller's list, the last aside
+struct byte_list {
+    int8_t* p;
+    size_t last;
+    int8_t extra = -1;
+
+    int get(size_t k) const { return k == last ? extra : p[k]; }
+    void set(size_t k, int v) { (k == last ? extra : p[k]) = int8_t(v); }
+};
+
+// as `byte_list`, one bit per symbol as in libbalance.h
+struct bit_list {
+    uint8_t* p;
+    size_t last;
+    int extra = -1;
+
+    int get(size_t k) const
+    {
+        if (k == last) {
+            return extra;
+        }
+        return (p[k / 8] >> (7 - k % 8)) & 1 ? 1 : -1;
+    }
+    void set(size_t k, int v)
+    {
+        if (k == last) {
+            extra = v;
+            return;
+        }
+        uint8_t bit = uint8_t(1u << (7 - k % 8));
+        p[k / 8] = v == 1 ? p[k / 8] | bit : p[k / 8] & ~bit;
+    }
+};
+
+template<class L>
+void swap_at(L& l, size_t i, size_t j)
+{
+    int a = l.get(i);
+    l.set(i, l.get(j));
+    l.set(j, a);
+}
+
+// reverses symbols [lo, hi)
+template<class L>
+void reverse(L& l, size_t lo, size_t hi)
+{
+    while (lo + 1 < hi) {
+        swap_at(l, lo++, --hi);
+    }
+}
+
+// makes the next balanced list of size n from `g` into `l`
+template<class L, class G>
+void make_list(L& l, size_t n, G& g)
+{
+    const size_t len = 2 * n + 1;
+    for (size_t k = 0; k < len; ++k) {
+        l.set(k, k < n ? 1 : -1);
+    }
+    // as `symbols::scramble`, draw for draw
+    for (size_t i = len - 1; i > 0; --i) {
+        swap_at(l, i, std::uniform_int_distribution<size_t>(0, i)(g));
+    }
+
+    long sum = 0, low = 0;
+    size_t valley = 0;
+    for (size_t k = 0; k < len; ++k) {
+        sum += l.get(k);
+        if (sum < low) {
+            low = sum;
+            valley = k;
+        }
+    }
+    // rotate left past the valley, leaving its -1 last, where it's dropped
+    reverse(l, 0, valley + 1);
+    reverse(l, valley + 1, len);
+    reverse(l, 0, len);
+}
+
+// true if the first `len` symbols of `l` are a balanced list
+template<class L>
+bool balanced(const L& l, size_t len)
+{
+    long sum = 0;
+    for (size_t k = 0; k < len; ++k) {
+        if ((sum += l.get(k)) < 0) {
+            return false;
+        }
+    }
+    return sum == 0;
+}
+
+size_t record_size(size_t n) { return (2 * n + 7) / 8; }
+
+template<class G>
+int fill_packed(G& g, uint8_t* out, size_t n, size_t count)
+{
+    if (!out || n == 0) {
+        return BALANCE_EINVAL;
+    }
+    const size_t rs = record_size(n);
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t* rec = out + i * rs;
+        // the padding bits are never set
+        std::memset(rec, 0, rs);
+        bit_list l{rec, 2 * n};
+        make_list(l, n, g);
+    }
+    return BALANCE_OK;
+}
+
+template<class G>
+int fill_bytes(G& g, int8_t* out, size_t n, size_t count)
+{
+    if (!out || n == 0) {
+        return BALANCE_EINVAL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        byte_list l{out + i * 2 * n, 2 * n};
+        make_list(l, n, g);
+    }
+    return BALANCE_OK;
+}
+
+using any_engine = std::variant<std::mt19937, xoshiro256x8>;
+
+// the engine `engine` seeded with `seed`, as `views::balanced` seeds it.
+// false if there's no such engine.
+bool make_engine(any_engine& g, uint64_t seed, int engine)
+{
+    switch (engine) {
+    case BALANCE_ENGINE_MT19937: {
+        seed_pair seq(seed);
+        g.emplace<std::mt19937>(seq);
+        return true;
+    }
+    case BALANCE_ENGINE_XOSHIRO256X8:
+        g.emplace<xoshiro256x8>(seed);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+struct balance_rng {
+    std::mutex m;
+    any_engine g;
+};
+
+extern "C" {
+
+const char* balance_strerror(int err)
+{
+    switch (err) {
+    case BALANCE_OK:
+        return "ok";
+    case BALANCE_EINVAL:
+        return "null buffer or n of 0";
+    case BALANCE_EENGINE:
+        return "unknown random engine";
+    default:
+        return "unknown error";
+    }
+}
+
+size_t balance_record_size(size_t n) { return record_size(n); }
+
+int balance_fill(uint8_t* out, size_t n, size_t count, uint64_t seed,
+                 int engine)
+{
+    any_engine g;
+    if (!make_engine(g, seed, engine)) {
+        return BALANCE_EENGINE;
+    }
+    return std::visit([&](auto& e) { return fill_packed(e, out, n, count); },
+                      g);
+}
+
+int balance_fill_bytes(int8_t* out, size_t n, size_t count, uint64_t seed,
+                       int engine)
+{
+    any_engine g;
+    if (!make_engine(g, seed, engine)) {
+        return BALANCE_EENGINE;
+    }
+    return std::visit([&](auto& e) { return fill_bytes(e, out, n, count); },
+                      g);
+}
+
+balance_rng* balance_rng_new(uint64_t seed, int engine)
+{
+    auto* rng = new (std::nothrow) balance_rng;
+    if (rng && !make_engine(rng->g, seed, engine)) {
+        delete rng;
+        return nullptr;
+    }
+    return rng;
+}
+
+void balance_rng_free(balance_rng* rng) { delete rng; }
+
+int balance_rng_fill(balance_rng* rng, uint8_t* out, size_t n, size_t count)
+{
+    if (!rng) {
+        return BALANCE_EINVAL;
+    }
+    std::lock_guard lock(rng->m);
+    return std::visit([&](auto& e) { return fill_packed(e, out, n, count); },
+                      rng->g);
+}
+
+int balance_rng_fill_bytes(balance_rng* rng, int8_t* out, size_t n,
+                           size_t count)
+{
+    if (!rng) {
+        return BALANCE_EINVAL;
+    }
+    std::lock_guard lock(rng->m);
+    return std::visit([&](auto& e) { return fill_bytes(e, out, n, count); },
+                      rng->g);
+}
+
+int balance_validate(const uint8_t* in, size_t n, size_t count,
+                     size_t* balanced)
+{
+    if (!in || !balanced || n == 0) {
+        return BALANCE_EINVAL;
+    }
+    const size_t rs = record_size(n);
+    *balanced = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // never written through, the extra symbol is past the end
+        const bit_list l{const_cast<uint8_t*>(in + i * rs), 2 * n};
+        *balanced += ::balanced(l, 2 * n);
+    }
+    return BALANCE_OK;
+}
+
+int balance_validate_bytes(const int8_t* in, size_t n, size_t count,
+                           size_t* balanced)
+{
+    if (!in || !balanced || n == 0) {
+        return BALANCE_EINVAL;
+    }
+    *balanced = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const byte_list l{const_cast<int8_t*>(in + i * 2 * n), 2 * n};
+        *balanced += ::balanced(l, 2 * n);
+    }
+    return BALANCE_OK;
+}
+
+} // extern "C"
+
+#ifdef TESTING
+#include <ranges>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+#include "outofcore.hpp"
+#include "stream.hpp"
+#include "views.hpp"
+
+TEST_CASE("libbalance")
+{
+    SUBCASE("seeding matches std::seed_seq")
+    {
+        for (uint64_t seed : {0ull, 1ull, 0xdeadbeefcafef00dull}) {
+            std::seed_seq seq{uint32_t(seed), uint32_t(seed >> 32)};
+            std::vector<uint32_t> want(624), got(624);
+            seq.generate(want.begin(), want.end());
+            seed_pair(seed).generate(got.begin(), got.end());
+            CHECK(want == got);
+        }
+    }
+
+    SUBCASE("the same lists as views::balanced")
+    {
+        for (auto [n, e] : {std::pair{1, 0}, {3, 0}, {4, 0}, {7, 0}, {64, 0},
+                            {100, 0}, {1, 1}, {4, 1}, {64, 1}, {100, 1}}) {
+            const size_t count = 50, rs = balance_record_size(n);
+            std::vector<uint8_t> packed(count * rs);
+            std::vector<int8_t> bytes(count * 2 * n);
+            REQUIRE_EQ(balance_fill(packed.data(), n, count, 7, e), 0);
+            REQUIRE_EQ(balance_fill_bytes(bytes.data(), n, count, 7, e), 0);
+
+            std::vector<uint8_t> want(rs);
+            size_t i = 0;
+            for (const auto& s : views::balanced(n, 7, engine(e)) |
+                                     std::views::take(count)) {
+                std::fill(want.begin(), want.end(), 0);
+                detail::pack(s.data(), s.size(), want.data());
+                CHECK(std::equal(want.begin(), want.end(),
+                                 packed.begin() + i * rs));
+                CHECK(std::equal(s.begin(), s.end(),
+                                 bytes.begin() + i * 2 * n));
+                ++i;
+            }
+        }
+    }
+
+    SUBCASE("handles carry on where they left off")
+    {
+        const size_t n = 20, rs = balance_record_size(n);
+        std::vector<uint8_t> all(30 * rs), parts(30 * rs);
+        REQUIRE_EQ(balance_fill(all.data(), n, 30, 42, 0), 0);
+
+        balance_rng* rng = balance_rng_new(42, 0);
+        REQUIRE(rng);
+        CHECK_EQ(balance_rng_fill(rng, parts.data(), n, 10), 0);
+        CHECK_EQ(balance_rng_fill(rng, parts.data() + 10 * rs, n, 20), 0);
+        balance_rng_free(rng);
+        CHECK(all == parts);
+
+        REQUIRE_EQ(balance_fill(all.data(), n, 30, 42, 1), 0);
+        rng = balance_rng_new(42, 1);
+        REQUIRE(rng);
+        CHECK_EQ(balance_rng_fill(rng, parts.data(), n, 7), 0);
+        CHECK_EQ(balance_rng_fill(rng, parts.data() + 7 * rs, n, 23), 0);
+        balance_rng_free(rng);
+        CHECK(all == parts);
+    }
+
+    SUBCASE("handles on several threads")
+    {
+        const size_t n = 16, count = 1000;
+        std::vector<std::vector<int8_t>> out(4,
+                                             std::vector<int8_t>(count * 2 * n));
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < out.size(); ++t) {
+            threads.emplace_back([&, t] {
+                balance_rng* rng = balance_rng_new(t, 0);
+                balance_rng_fill_bytes(rng, out[t].data(), n, count);
+                balance_rng_free(rng);
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        for (const auto& o : out) {
+            size_t ok = 0;
+            CHECK_EQ(balance_validate_bytes(o.data(), n, count, &ok), 0);
+            CHECK_EQ(ok, count);
+        }
+        CHECK(out[0] != out[1]);
+    }
+
+    SUBCASE("validate")
+    {
+        const size_t n = 5, rs = balance_record_size(n);
+        std::vector<uint8_t> packed(8 * rs);
+        REQUIRE_EQ(balance_fill(packed.data(), n, 8, 1, 0), 0);
+        size_t ok = 0;
+        CHECK_EQ(balance_validate(packed.data(), n, 8, &ok), 0);
+        CHECK_EQ(ok, 8);
+        // every balanced list starts with a 1
+        packed[3 * rs] &= 0x7f;
+        CHECK_EQ(balance_validate(packed.data(), n, 8, &ok), 0);
+        CHECK_EQ(ok, 7);
+    }
+
+    SUBCASE("errors")
+    {
+        uint8_t buf[4];
+        size_t ok;
+        CHECK_EQ(balance_fill(nullptr, 4, 1, 0, 0), BALANCE_EINVAL);
+        CHECK_EQ(balance_fill(buf, 0, 1, 0, 0), BALANCE_EINVAL);
+        CHECK_EQ(balance_fill(buf, 4, 1, 0, 9), BALANCE_EENGINE);
+        CHECK_EQ(balance_validate(buf, 4, 1, nullptr), BALANCE_EINVAL);
+        CHECK_EQ(balance_validate(buf, 0, 1, &ok), BALANCE_EINVAL);
+        CHECK_FALSE(balance_rng_new(0, 9));
+        CHECK_EQ(balance_rng_fill(nullptr, buf, 4, 1), BALANCE_EINVAL);
+        CHECK_EQ(std::string(balance_strerror(BALANCE_EENGINE)),
+                 "unknown random engine");
+    }
+}
+
+#endif
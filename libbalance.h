@@ -0,0 +1,95 @@
+#ifndef LIBBALANCE_H
+#define LIBBALANCE_H
+
+/*
+ * random balanced lists for C and C++ programs, without a lab4.out.
+ *
+ * build with `make lib` and link with -lbalance (and -lstdc++ from C).
+ *
+ * a list of size n is 2n symbols, each 1 or -1, whose prefix sums never go
+ * below 0. lists come out in one of two layouts, in buffers the caller owns:
+ *
+ *   packed  each list in balance_record_size(n) bytes, 1 bit per symbol,
+ *           first symbol in the most significant bit, 1 for a 1 and 0 for a
+ *           -1, padded with 0s to a whole byte. the same as the records of
+ *           a binary stream, so they can be written straight after its
+ *           header.
+ *   bytes   each list as 2n int8_t, 1 or -1.
+ *
+ * nothing here allocates except balance_rng_new, and nothing keeps global
+ * state, so any number of threads can fill at once.
+ *
+ * every function returning int returns BALANCE_OK or a negative
+ * BALANCE_E* code.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* random engines, as in a stream header */
+#define BALANCE_ENGINE_MT19937 0
+#define BALANCE_ENGINE_XOSHIRO256X8 1 /* eight lanes at once, much faster */
+
+#define BALANCE_OK 0
+#define BALANCE_EINVAL -1  /* null buffer or n of 0 */
+#define BALANCE_EENGINE -2 /* unknown engine */
+
+/* a message for a BALANCE_E* code */
+const char* balance_strerror(int err);
+
+/* bytes per packed list of size n */
+size_t balance_record_size(size_t n);
+
+/*
+ * fills `out` with `count` packed lists of size `n`.
+ *
+ * the same seed and engine always give the same lists. with
+ * BALANCE_ENGINE_MT19937 they're the ones `./lab4.out dump n count seed`
+ * writes.
+ */
+int balance_fill(uint8_t* out, size_t n, size_t count, uint64_t seed,
+                 int engine);
+
+/* as balance_fill, with each list as 2n bytes */
+int balance_fill_bytes(int8_t* out, size_t n, size_t count, uint64_t seed,
+                       int engine);
+
+/*
+ * a random engine that carries on from one fill to the next. fills on one
+ * handle from several threads are serialized, so give each thread its own
+ * to fill in parallel.
+ */
+typedef struct balance_rng balance_rng;
+
+/* NULL for an unknown engine or out of memory */
+balance_rng* balance_rng_new(uint64_t seed, int engine);
+void balance_rng_free(balance_rng* rng);
+
+/*
+ * the next `count` lists of size `n` from `rng`. a new handle's first fill
+ * matches balance_fill with its seed.
+ */
+int balance_rng_fill(balance_rng* rng, uint8_t* out, size_t n, size_t count);
+int balance_rng_fill_bytes(balance_rng* rng, int8_t* out, size_t n,
+                           size_t count);
+
+/*
+ * sets `*balanced` to how many of the `count` packed lists of size `n` in
+ * `in` are balanced.
+ */
+int balance_validate(const uint8_t* in, size_t n, size_t count,
+                     size_t* balanced);
+
+/* as balance_validate, with each list as 2n bytes */
+int balance_validate_bytes(const int8_t* in, size_t n, size_t count,
+                           size_t* balanced);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,110 @@
+#ifdef TESTING
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "balance.hpp"
+#include "doctest.h"
+#include "memory.hpp"
+
+// the global operator new and delete, counted. the array, nothrow and sized
+// forms all end up in these. only in the tests, so the program itself
+// doesn't pay for the counting on every allocation.
+
+namespace {
+
+std::atomic<size_t> nnew{0};
+std::atomic<size_t> ndelete{0};
+
+void* counted_alloc(size_t n, size_t align)
+{
+    nnew.fetch_add(1, std::memory_order_relaxed);
+    n = std::max<size_t>(n, 1);
+    void* p = align <= alignof(std::max_align_t)
+                  ? std::malloc(n)
+                  : std::aligned_alloc(align, (n + align - 1) / align * align);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void counted_free(void* p)
+{
+    if (p) {
+        ndelete.fetch_add(1, std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+} // namespace
+
+size_t heap_allocations() { return nnew.load(std::memory_order_relaxed); }
+size_t heap_deallocations() { return ndelete.load(std::memory_order_relaxed); }
+
+void* operator new(size_t n) { return counted_alloc(n, 0); }
+void* operator new(size_t n, std::align_val_t a)
+{
+    return counted_alloc(n, size_t(a));
+}
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete(void* p, size_t) noexcept { counted_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    counted_free(p);
+}
+
+TEST_CASE("counting_resource")
+{
+    counting_resource counter;
+    {
+        std::pmr::vector<int> v(&counter);
+        v.reserve(100);
+        CHECK_EQ(counter.allocations(), 1);
+        CHECK_EQ(counter.in_use(), 100 * sizeof(int));
+        v.reserve(1000);
+        CHECK_EQ(counter.allocations(), 2);
+        CHECK_EQ(counter.deallocations(), 1);
+    }
+    CHECK_EQ(counter.deallocations(), 2);
+    CHECK_EQ(counter.in_use(), 0);
+    CHECK_EQ(counter.peak(), 1100 * sizeof(int));
+
+    counter.reset();
+    CHECK_EQ(counter.allocations(), 0);
+    CHECK_EQ(counter.peak(), 0);
+
+    SUBCASE("global new and delete")
+    {
+        size_t news = heap_allocations(), deletes = heap_deallocations();
+        auto p = std::make_unique<int>(1);
+        CHECK_EQ(heap_allocations(), news + 1);
+        p.reset();
+        std::vector<double> v(10);
+        v.reserve(100);
+        CHECK_EQ(heap_allocations(), news + 3);
+        CHECK_EQ(heap_deallocations(), deletes + 2);
+    }
+
+    SUBCASE("symbols on an arena")
+    {
+        std::pmr::monotonic_buffer_resource arena(1 << 16, &counter);
+        auto syms = symbols::generate_n(8, 1000, &arena);
+        size_t elsewhere = 0;
+        for (auto& s : syms) {
+            s.scramble();
+            s.cut_and_splice();
+            elsewhere += s.get_allocator().resource() != &arena;
+        }
+        CHECK_EQ(elsewhere, 0);
+        // the arena grows geometrically, a handful of blocks for 2000
+        // vectors
+        CHECK_LT(counter.allocations(), 10);
+    }
+}
+
+#endif
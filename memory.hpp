@@ -0,0 +1,82 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+
+#ifdef TESTING
+// calls to the global operator new and delete so far, all threads together.
+//
+// counted by the replacements in memory.cpp, which are only built into the
+// tests, for them to check that a loop stays off the heap:
+//
+//     size_t before = heap_allocations();
+//     ...
+//     CHECK_EQ(heap_allocations(), before);
+size_t heap_allocations();
+size_t heap_deallocations();
+#endif
+
+// a memory resource that passes everything on to `upstream` and counts it,
+// to see how often a part of the program goes to the heap.
+//
+//     counting_resource counter;
+//     std::pmr::monotonic_buffer_resource arena(&counter);
+//     ...
+//     std::cout << counter.allocations() << std::endl;
+class counting_resource : public std::pmr::memory_resource {
+public:
+    explicit counting_resource(
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : up(upstream)
+    {
+    }
+
+    // calls to allocate so far
+    size_t allocations() const { return nallocs; }
+    // calls to deallocate so far
+    size_t deallocations() const { return nfrees; }
+    // bytes allocated and not yet deallocated
+    size_t in_use() const { return used; }
+    // most bytes there have been in use at once
+    size_t peak() const { return high; }
+
+    void reset()
+    {
+        nallocs = nfrees = 0;
+        high = used;
+    }
+
+    std::pmr::memory_resource* upstream() const { return up; }
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override
+    {
+        void* p = up->allocate(bytes, align);
+        ++nallocs;
+        used += bytes;
+        high = std::max(high, used);
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override
+    {
+        up->deallocate(p, bytes, align);
+        ++nfrees;
+        used -= bytes;
+    }
+
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* up;
+    size_t nallocs = 0;
+    size_t nfrees = 0;
+    size_t used = 0;
+    size_t high = 0;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifdef TESTING
+#include <filesystem>
+#include <fstream>
+
+#include "doctest.h"
+#include "outofcore.hpp"
+
+TEST_CASE("packed sequence files")
+{
+    auto dir = std::filesystem::temp_directory_path();
+    std::string in = dir / "lab4test_in.bin";
+    std::string out = dir / "lab4test_out.bin";
+
+    SUBCASE("round trip")
+    {
+        symbols s(13);
+        s.scramble();
+        write_packed(in, s);
+        CHECK_EQ(std::filesystem::file_size(in), 8 + (27 + 7) / 8);
+        CHECK_EQ(read_packed(in), s);
+    }
+
+    SUBCASE("splice_file matches cut_and_splice")
+    {
+        // tiny blocks so the valley search spans many of them
+        for (size_t n : {1, 4, 50, 1000}) {
+            for (size_t block : {8, 64, 1 << 22}) {
+                symbols s(n);
+                s.scramble();
+                write_packed(in, s);
+
+                size_t valley = splice_file(in, out, block);
+                CHECK_EQ(valley, s.lowest_valley() - s.cbegin());
+                s.cut_and_splice();
+                CHECK_EQ(read_packed(out), s);
+            }
+        }
+    }
+
+    SUBCASE("rejects sequences that can't be balanced")
+    {
+        symbols s = {1, -1, 1, -1};
+        write_packed(in, s);
+        CHECK_THROWS(splice_file(in, out));
+        CHECK_THROWS(splice_file(dir / "lab4test_missing.bin", out));
+    }
+
+    SUBCASE("the count is little-endian and checked against the file")
+    {
+        symbols s(13);
+        write_packed(in, s);
+        std::ifstream f(in, std::ios::binary);
+        CHECK_EQ(f.get(), 27);
+        CHECK_EQ(f.get(), 0);
+        f.close();
+
+        // a count near 2^64 with no symbols after it
+        std::ofstream(in, std::ios::binary) << std::string(8, '\xff');
+        CHECK_THROWS_WITH(read_packed(in), (in + ": truncated").c_str());
+        CHECK_THROWS_WITH(splice_file(in, out),
+                          (in + ": truncated").c_str());
+        std::ofstream(in, std::ios::binary) << std::string(7, '\0');
+        CHECK_THROWS(read_packed(in));
+    }
+
+    std::filesystem::remove(in);
+    std::filesystem::remove(out);
+}
+
+#endif
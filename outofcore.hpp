@@ -0,0 +1,421 @@
+#ifndef OUTOFCORE_HPP
+#define OUTOFCORE_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "balance.hpp"
+#include "prefix.hpp"
+
+// cut-and-splice for sequences too large to fit in memory.
+//
+// a packed sequence file is an 8 byte little-endian count of symbols followed
+// by the symbols one bit each, first symbol in the most significant bit of the
+// first byte, 1 for a 1 and 0 for a -1.
+
+namespace detail {
+
+inline std::runtime_error sys_error(const std::string& what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+inline void put_le(uint8_t* p, uint64_t v, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i) {
+        p[i] = uint8_t(v >> (8 * i));
+    }
+}
+
+inline uint64_t get_le(const uint8_t* p, size_t bytes)
+{
+    uint64_t v = 0;
+    for (size_t i = bytes; i-- > 0;) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+// writes all of [p, p + n) to `fd`, however many calls it takes
+inline void write_all(int fd, const void* p, size_t n)
+{
+    auto b = static_cast<const uint8_t*>(p);
+    size_t off = 0;
+    while (off < n) {
+        ssize_t w = ::write(fd, b + off, n - off);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw sys_error("write");
+        }
+        off += w;
+    }
+}
+
+// buffered sink of bits, flushed with large write(2) calls
+class bit_writer {
+public:
+    explicit bit_writer(int fd, size_t bufsize = 1 << 20)
+        : fd(fd), buf(bufsize)
+    {
+    }
+
+    // appends the low `k` (<= 56) bits of `bits`, most significant first
+    void put(uint64_t bits, int k)
+    {
+        acc = (acc << k) | (bits & ((1ull << k) - 1));
+        nacc += k;
+        while (nacc >= 8) {
+            nacc -= 8;
+            buf[used++] = uint8_t(acc >> nacc);
+            if (used == buf.size()) {
+                flush();
+            }
+        }
+    }
+
+    void put_bytes(const void* p, size_t n)
+    {
+        auto b = static_cast<const uint8_t*>(p);
+        for (size_t i = 0; i < n; ++i) {
+            put(b[i], 8);
+        }
+    }
+
+    // pads the last byte with 0s and writes everything out
+    void finish()
+    {
+        if (nacc > 0) {
+            put(0, 8 - nacc);
+        }
+        flush();
+    }
+
+private:
+    void flush()
+    {
+        write_all(fd, buf.data(), used);
+        used = 0;
+    }
+
+    int fd;
+    std::vector<uint8_t> buf;
+    size_t used = 0;
+    uint64_t acc = 0;
+    int nacc = 0;
+};
+
+// read-only memory map of a whole file
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw sys_error(path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) < 0) {
+            ::close(fd);
+            throw sys_error(path);
+        }
+        len = st.st_size;
+        if (len > 0) {
+            void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw sys_error(path);
+            }
+            addr = static_cast<const uint8_t*>(p);
+            ::madvise(p, len, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file()
+    {
+        if (addr) {
+            ::munmap(const_cast<uint8_t*>(addr), len);
+        }
+    }
+
+    const uint8_t* data() const { return addr; }
+    size_t size() const { return len; }
+
+    // drops the pages wholly inside [lo, hi) so resident memory stays
+    // constant as a pass moves through the file
+    void release(size_t lo, size_t hi) const
+    {
+        const size_t page = ::sysconf(_SC_PAGESIZE);
+        lo = (lo + page - 1) / page * page;
+        hi = hi / page * page;
+        if (lo < hi) {
+            ::madvise(const_cast<uint8_t*>(addr) + lo, hi - lo, MADV_DONTNEED);
+        }
+    }
+
+private:
+    const uint8_t* addr = nullptr;
+    size_t len = 0;
+};
+
+// the symbol count at the start of the packed sequence file `f`, checked
+// against the bytes after it. compared in bits, as the byte count
+// (len + 7) / 8 wraps for a count near 2^64.
+inline uint64_t packed_length(const mapped_file& f, const std::string& path)
+{
+    if (f.size() < 8) {
+        throw std::runtime_error(path + ": not a packed sequence file");
+    }
+    uint64_t len = get_le(f.data(), 8);
+    if (len > (f.size() - 8) * 8) {
+        throw std::runtime_error(path + ": truncated");
+    }
+    return len;
+}
+
+// `k` (<= 56) packed bits starting at bit `pos`
+inline uint64_t get_bits(const uint8_t* bits, size_t pos, int k)
+{
+    uint64_t w = 0;
+    size_t first = pos / 8, last = (pos + k + 7) / 8;
+    for (size_t i = first; i < last; ++i) {
+        w = (w << 8) | bits[i];
+    }
+    int extra = int(last * 8 - (pos + k));
+    return (w >> extra) & ((1ull << k) - 1);
+}
+
+// unpacks `n` symbols starting at symbol `pos` into `out`
+inline void unpack(const uint8_t* bits, size_t pos, size_t n, int8_t* out)
+{
+    for (size_t i = 0; i < n; ++i) {
+        size_t p = pos + i;
+        out[i] = (bits[p / 8] >> (7 - p % 8)) & 1 ? 1 : -1;
+    }
+}
+
+// packs the `n` symbols at `in` into (n + 7) / 8 bytes at `out`, the last
+// byte padded with 0s. the inverse of `unpack`.
+inline void pack(const int8_t* in, size_t n, uint8_t* out)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint8_t b = 0;
+        for (size_t j = 0; j < 8; ++j) {
+            b = (b << 1) | (in[i + j] == 1);
+        }
+        *out++ = b;
+    }
+    if (i < n) {
+        uint8_t b = 0;
+        for (size_t j = 0; j < 8; ++j) {
+            b = (b << 1) | (i + j < n && in[i + j] == 1);
+        }
+        *out = b;
+    }
+}
+
+} // namespace detail
+
+// all of an input file mapped at once, or a file descriptor read in large
+// blocks. the unconsumed bytes are always contiguous.
+class input_buffer {
+public:
+    static constexpr size_t BLOCK = 1 << 20;
+
+    // maps `path`, or reads standard input if it is "-"
+    explicit input_buffer(const std::string& path)
+    {
+        if (path == "-") {
+            fd = STDIN_FILENO;
+        }
+        else {
+            map = std::make_unique<detail::mapped_file>(path);
+            begin = map->data();
+            end = begin + map->size();
+        }
+    }
+
+    const uint8_t* data() const { return begin; }
+    size_t size() const { return end - begin; }
+
+    void consume(size_t n)
+    {
+        if (map) {
+            // drop what's behind so resident memory stays small
+            size_t lo = last_release, hi = begin + n - map->data();
+            if (hi - lo >= BLOCK) {
+                map->release(lo, hi);
+                last_release = hi;
+            }
+        }
+        begin += n;
+    }
+
+    // reads at least one more block onto the end, keeping the unconsumed
+    // bytes. false at the end of the input.
+    bool more()
+    {
+        if (map || eof) {
+            return false;
+        }
+        size_t keep = size();
+        if (buf.size() < keep + BLOCK) {
+            std::vector<uint8_t> bigger(keep + BLOCK);
+            std::memcpy(bigger.data(), begin, keep);
+            buf = std::move(bigger);
+        }
+        else {
+            std::memmove(buf.data(), begin, keep);
+        }
+        begin = buf.data();
+        end = begin + keep;
+
+        ssize_t r;
+        do {
+            r = ::read(fd, buf.data() + keep, buf.size() - keep);
+        } while (r < 0 && errno == EINTR);
+        if (r < 0) {
+            throw detail::sys_error("read");
+        }
+        eof = r == 0;
+        end += r;
+        total += r;
+        return r > 0;
+    }
+
+    // bytes read so far
+    size_t bytes() const { return map ? map->size() : total; }
+
+private:
+    std::unique_ptr<detail::mapped_file> map;
+    size_t last_release = 0;
+    int fd = -1;
+    bool eof = false;
+    std::vector<uint8_t> buf;
+    size_t total = 0;
+    const uint8_t* begin = nullptr;
+    const uint8_t* end = nullptr;
+};
+
+// writes `s` to `path` as a packed sequence file
+inline void write_packed(const std::string& path, const symbols& s)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw detail::sys_error(path);
+    }
+    detail::bit_writer out(fd);
+    uint8_t len[8];
+    detail::put_le(len, s.size(), sizeof(len));
+    out.put_bytes(len, sizeof(len));
+    for (const auto& i : s) {
+        out.put(i == 1 ? 1 : 0, 1);
+    }
+    out.finish();
+    ::close(fd);
+}
+
+// reads a whole packed sequence file
+inline symbols read_packed(const std::string& path)
+{
+    detail::mapped_file in(path);
+    uint64_t len = detail::packed_length(in, path);
+    symbols s(len, 0);
+    detail::unpack(in.data() + sizeof(len), 0, len, s.data());
+    return s;
+}
+
+// performs the [P2:P1'] splicing from the assignment algorithm on the packed
+// sequence in `in`, writing the balanced result to `out`.
+//
+// the input is memory mapped and scanned `block` symbols at a time with the
+// same prefix kernels as `symbols::lowest_valley`, keeping only the lowest
+// valley found so far, then the two halves are copied to `out` with
+// sequential writes. memory use does not depend on the size of the input.
+//
+// returns the index of the lowest valley. throws if the input does not have
+// exactly one more -1 than 1s, as it could not be balanced.
+inline size_t splice_file(const std::string& in, const std::string& out,
+                          size_t block = 1 << 22)
+{
+    detail::mapped_file src(in);
+    uint64_t len = detail::packed_length(src, in);
+    const uint8_t* bits = src.data() + sizeof(len);
+    block = std::max<size_t>(block / 8 * 8, 8);
+
+    // pass 1: find the block holding the first lowest valley
+    std::vector<int8_t> scratch(block);
+    long offset = 0, low = std::numeric_limits<long>::max();
+    long low_offset = 0;
+    size_t low_block = 0;
+    for (size_t lo = 0; lo < len; lo += block) {
+        size_t n = std::min<size_t>(block, len - lo);
+        detail::unpack(bits, lo, n, scratch.data());
+        auto s = summarize(std::span<const int8_t>(scratch.data(), n));
+        if (offset + s.min < low) {
+            low = offset + s.min;
+            low_offset = offset;
+            low_block = lo;
+        }
+        offset += s.sum;
+        src.release(sizeof(len) + lo / 8, sizeof(len) + (lo + n) / 8);
+    }
+    if (offset != -1) {
+        throw std::runtime_error(in + ": needs exactly one more -1 than 1s");
+    }
+
+    size_t n = std::min<size_t>(block, len - low_block);
+    detail::unpack(bits, low_block, n, scratch.data());
+    size_t valley =
+        low_block + first_prefix_at(std::span<const int8_t>(scratch.data(), n),
+                                    low, low_offset);
+
+    // pass 2: write P2 (after the valley) then P1 without its final -1
+    int fd = ::open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw detail::sys_error(out);
+    }
+    detail::bit_writer dst(fd);
+    uint8_t outlen[8];
+    detail::put_le(outlen, len - 1, sizeof(outlen));
+    dst.put_bytes(outlen, sizeof(outlen));
+
+    auto copy = [&](size_t lo, size_t hi) {
+        ::madvise(const_cast<uint8_t*>(src.data()), src.size(),
+                  MADV_SEQUENTIAL);
+        for (size_t p = lo; p < hi;) {
+            int k = int(std::min<size_t>(56, hi - p));
+            dst.put(detail::get_bits(bits, p, k), k);
+            p += k;
+            if (p % block < 56) {
+                src.release(sizeof(len) + lo / 8, sizeof(len) + p / 8);
+            }
+        }
+    };
+    copy(valley + 1, len);
+    copy(0, valley);
+    dst.finish();
+    if (::close(fd) < 0) {
+        throw detail::sys_error(out);
+    }
+    return valley;
+}
+
+#endif
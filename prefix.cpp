@@ -1,5 +1,11 @@
 #ifdef TESTING
 
+#include <cstdint>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <vector>
+
 #include "prefix.hpp"
 
 #include "doctest.h"
@@ -37,6 +43,16 @@ TEST_CASE("non_neg_prefix_sum")
         std::swap(data[1 << 10], data[(1 << 10) + 1]);
         CHECK_FALSE(non_neg_prefix_sum(data));
     }
+
+    SUBCASE("int8 sums past 127 through a non-contiguous view")
+    {
+        std::vector<int8_t> data(200, 1);
+        data.resize(400, -1);
+        auto all = std::views::filter([](int8_t) { return true; });
+        CHECK(non_neg_prefix_sum(data | all));
+        data.push_back(-1);
+        CHECK_FALSE(non_neg_prefix_sum(data | all));
+    }
 }
 
 TEST_CASE("non_pos_prefix_sum")
@@ -72,6 +88,139 @@ TEST_CASE("non_pos_prefix_sum")
         std::swap(data[1 << 10], data[(1 << 10) + 1]);
         CHECK_FALSE(non_pos_prefix_sum(data));
     }
+
+    SUBCASE("int8 sums past -128 through a non-contiguous view")
+    {
+        std::vector<int8_t> data(200, -1);
+        data.resize(400, 1);
+        auto all = std::views::filter([](int8_t) { return true; });
+        CHECK(non_pos_prefix_sum(data | all));
+        data.push_back(1);
+        CHECK_FALSE(non_pos_prefix_sum(data | all));
+    }
+}
+
+TEST_CASE("summarize")
+{
+    // a long walk that isn't just +-1, with an awkward length
+    std::vector<int8_t> data(100003);
+    std::mt19937 gen{};
+    std::uniform_int_distribution<int> dist(-3, 3);
+    std::ranges::generate(data, [&] { return dist(gen); });
+
+    prefix_summary expect;
+    for (const auto& i : data) {
+        expect.sum += i;
+        expect.min = std::min(expect.min, expect.sum);
+        expect.max = std::max(expect.max, expect.sum);
+    }
+
+    auto check = [&](const prefix_summary& s) {
+        CHECK_EQ(s.sum, expect.sum);
+        CHECK_EQ(s.min, expect.min);
+        CHECK_EQ(s.max, expect.max);
+        CHECK_EQ(s.size, data.size());
+    };
+
+    SUBCASE("simd")
+    {
+        check(summarize(std::span<const int8_t>(data)));
+    }
+
+    SUBCASE("scalar")
+    {
+        std::vector<int> wide(data.begin(), data.end());
+        check(summarize(std::span<const int>(wide)));
+    }
+
+    SUBCASE("parallel")
+    {
+        for (size_t threads : {1, 3, 8}) {
+            check(parallel_summarize(std::span<const int8_t>(data), threads));
+        }
+    }
+
+    SUBCASE("parallel_lowest_valley")
+    {
+        size_t i = first_prefix_at(std::span<const int8_t>(data), expect.min);
+        for (size_t threads : {1, 3, 8}) {
+            CHECK_EQ(parallel_lowest_valley(std::span<const int8_t>(data),
+                                            threads),
+                     i);
+        }
+    }
+
+    SUBCASE("empty")
+    {
+        auto s = summarize(std::span<const int8_t>());
+        CHECK_EQ(s.size, 0);
+        CHECK_EQ(s.sum, 0);
+    }
+}
+
+TEST_CASE("parallel_non_neg_prefix_sum")
+{
+    // several scan blocks of {1,-1,1,...}
+    std::vector<int8_t> data(5 * (1 << 20) + 7);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i % 2 ? -1 : 1;
+    }
+    for (size_t threads : {1, 4}) {
+        CHECK(parallel_non_neg_prefix_sum(std::span<const int8_t>(data),
+                                          threads));
+    }
+    CHECK(non_neg_prefix_sum(data));
+
+    // dip below 0 in the fourth block
+    size_t at = 3 * (1 << 20) + 10;
+    std::swap(data[at], data[at + 1]);
+    for (size_t threads : {1, 4}) {
+        CHECK_FALSE(parallel_non_neg_prefix_sum(std::span<const int8_t>(data),
+                                                threads));
+    }
+    CHECK_FALSE(non_neg_prefix_sum(data));
+}
+
+TEST_CASE("single-pass and non-const ranges")
+{
+    SUBCASE("istream_view")
+    {
+        std::istringstream good("1 -1 1 1 -1 -1");
+        CHECK(non_neg_prefix_sum(std::views::istream<int>(good)));
+
+        // stops reading at the first negative sum
+        std::istringstream bad("1 -1 -1 1 7 8");
+        CHECK_FALSE(non_neg_prefix_sum(std::views::istream<int>(bad)));
+        int next;
+        bad >> next;
+        CHECK_EQ(next, 1);
+
+        std::istringstream neg("-1 1 -1 1");
+        CHECK(non_pos_prefix_sum(std::views::istream<int>(neg)));
+    }
+
+    SUBCASE("filter view, which is not const-iterable")
+    {
+        const std::vector<int> data = {1, 5, -1, 5, 1, -1};
+        auto no5s = data | std::views::filter([](int i) { return i != 5; });
+        CHECK(non_neg_prefix_sum(no5s));
+        auto no1s = data | std::views::filter([](int i) { return i != 1; });
+        CHECK(non_pos_prefix_sum(no1s | std::views::transform(
+                                            [](int i) { return -i; })));
+    }
+
+    SUBCASE("generated lazily")
+    {
+        // {1,-1,1,-1,...} that never exists in memory
+        auto gen = std::views::iota(0, 1 << 20) |
+                   std::views::transform([](int i) { return i % 2 ? -1 : 1; });
+        CHECK(non_neg_prefix_sum(gen));
+
+        // an unbounded generator that goes negative eventually
+        auto down = std::views::iota(0) |
+                    std::views::transform([](int i) { return i < 100 ? 1 : -1; });
+        CHECK_FALSE(non_neg_prefix_sum(down));
+    }
 }
 
 #endif
@@ -1,36 +1,332 @@
 #ifndef PREFIX_HPP
 #define PREFIX_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 #include <ranges>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * summary of the prefix sums of a range: the total, and the lowest and highest
+ * of the sums of its non-empty prefixes.
+ */
+struct prefix_summary {
+    long sum = 0;
+    long min = std::numeric_limits<long>::max();
+    long max = std::numeric_limits<long>::min();
+    size_t size = 0;
+};
+
+/*
+ * summary of the range `a` followed by the range `b`
+ */
+inline prefix_summary combine(const prefix_summary& a, const prefix_summary& b)
+{
+    if (b.size == 0) {
+        return a;
+    }
+    return {a.sum + b.sum, std::min(a.min, a.sum + b.min),
+            std::max(a.max, a.sum + b.max), a.size + b.size};
+}
+
+namespace detail {
+
+// sums are kept in 32 bits within a chunk this long, even for int8 input
+constexpr size_t SIMD_CHUNK = 1 << 16;
+
+typedef int8_t v16qi __attribute__((vector_size(16)));
+typedef int32_t v16si __attribute__((vector_size(64)));
+
+// summary of up to SIMD_CHUNK int8s, 16 at a time.
+//
+// each group of 16 is prefix-summed in-register with 4 shift-and-adds, then
+// offset by the running total and folded into the running min and max.
+inline prefix_summary summarize_simd(const int8_t* p, size_t n)
+{
+    const v16si zero{};
+    v16si carry{}, lo = zero + std::numeric_limits<int32_t>::max(),
+                   hi = zero + std::numeric_limits<int32_t>::min();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        v16qi raw;
+        std::copy_n(p + i, 16, reinterpret_cast<int8_t*>(&raw));
+        v16si v = __builtin_convertvector(raw, v16si);
+        // shuffle indices >= 16 pick from `v`, the rest are 0
+        v += __builtin_shuffle(zero, v,
+                               v16si{0, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+                                     25, 26, 27, 28, 29, 30});
+        v += __builtin_shuffle(zero, v,
+                               v16si{0, 0, 16, 17, 18, 19, 20, 21, 22, 23,
+                                     24, 25, 26, 27, 28, 29});
+        v += __builtin_shuffle(zero, v,
+                               v16si{0, 0, 0, 0, 16, 17, 18, 19, 20, 21, 22,
+                                     23, 24, 25, 26, 27});
+        v += __builtin_shuffle(zero, v,
+                               v16si{0, 0, 0, 0, 0, 0, 0, 0, 16, 17, 18, 19,
+                                     20, 21, 22, 23});
+        v += carry;
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+        carry = zero + v[15];
+    }
+
+    prefix_summary s{carry[0], std::numeric_limits<long>::max(),
+                     std::numeric_limits<long>::min(), i};
+    if (i > 0) {
+        for (int l = 0; l < 16; ++l) {
+            s.min = std::min<long>(s.min, lo[l]);
+            s.max = std::max<long>(s.max, hi[l]);
+        }
+    }
+    // leftovers
+    for (; i < n; ++i) {
+        s.sum += p[i];
+        s.min = std::min(s.min, s.sum);
+        s.max = std::max(s.max, s.sum);
+        ++s.size;
+    }
+    return s;
+}
+
+} // namespace detail
+
+/*
+ * summary of the prefix sums of `r`. vectorized for int8 input.
+ */
+template<std::integral T>
+prefix_summary summarize(std::span<const T> r)
+{
+    prefix_summary s;
+    if constexpr (std::same_as<T, int8_t>) {
+        for (size_t i = 0; i < r.size(); i += detail::SIMD_CHUNK) {
+            size_t n = std::min(detail::SIMD_CHUNK, r.size() - i);
+            s = combine(s, detail::summarize_simd(r.data() + i, n));
+        }
+    }
+    else {
+        for (const T& i : r) {
+            s.sum += i;
+            s.min = std::min(s.min, s.sum);
+            s.max = std::max(s.max, s.sum);
+        }
+        s.size = r.size();
+    }
+    return s;
+}
+
+/*
+ * index of the first element of `r` at which the prefix sum, starting from
+ * `offset`, is `target`. r.size() if it never is.
+ */
+template<std::integral T>
+size_t first_prefix_at(std::span<const T> r, long target, long offset = 0)
+{
+    long sum = offset;
+    for (size_t i = 0; i < r.size(); ++i) {
+        sum += r[i];
+        if (sum == target) {
+            return i;
+        }
+    }
+    return r.size();
+}
+
+/*
+ * ranges at least this long are worth splitting across threads: past the
+ * size of a typical L2 cache.
+ */
+constexpr size_t PARALLEL_THRESHOLD = 1 << 22;
+
+namespace detail {
+
+// elements per block of the parallel scans
+constexpr size_t SCAN_BLOCK = 1 << 20;
+
+// phase one of the blocked scans: summarizes every SCAN_BLOCK of `r` on
+// `nthreads` threads.
+//
+// blocks are handed out in order, so whichever prefix of blocks is done can be
+// checked by `done(k, offset, summary)` as soon as block k finishes (in order,
+// under a lock). once it returns true the remaining blocks are skipped and the
+// returned summaries are incomplete.
+template<std::integral T, class F>
+std::vector<prefix_summary> summarize_blocks(std::span<const T> r,
+                                             size_t nthreads, F done)
+{
+    const size_t nblocks = (r.size() + SCAN_BLOCK - 1) / SCAN_BLOCK;
+    std::vector<prefix_summary> blocks(nblocks);
+    std::vector<char> finished(nblocks, 0);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> cancel{false};
+    std::mutex m;
+    size_t resolved = 0; // blocks [0, resolved) have been checked
+    long offset = 0;
+
+    auto work = [&] {
+        size_t b;
+        while (!cancel.load(std::memory_order_relaxed) &&
+               (b = next.fetch_add(1)) < nblocks) {
+            size_t lo = b * SCAN_BLOCK;
+            size_t n = std::min(SCAN_BLOCK, r.size() - lo);
+            blocks[b] = summarize(r.subspan(lo, n));
+
+            std::lock_guard lock(m);
+            finished[b] = 1;
+            while (resolved < nblocks && finished[resolved]) {
+                if (done(resolved, offset, blocks[resolved])) {
+                    cancel = true;
+                    return;
+                }
+                offset += blocks[resolved++].sum;
+            }
+        }
+    };
+
+    nthreads = std::clamp<size_t>(nthreads, 1, std::max<size_t>(nblocks, 1));
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < nthreads; ++t) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& t : threads) {
+        t.join();
+    }
+    return blocks;
+}
+
+} // namespace detail
+
+/*
+ * `summarize` split into blocks across `nthreads` threads
+ */
+template<std::integral T>
+prefix_summary
+parallel_summarize(std::span<const T> r,
+                   size_t nthreads = std::thread::hardware_concurrency())
+{
+    auto blocks = detail::summarize_blocks(
+        r, nthreads, [](size_t, long, const prefix_summary&) { return false; });
+    prefix_summary s;
+    for (const auto& b : blocks) {
+        s = combine(s, b);
+    }
+    return s;
+}
+
+/*
+ * index of the first lowest prefix sum of `r`, across `nthreads` threads.
+ *
+ * blocks are summarized in parallel, the summaries are scanned to find the
+ * first block reaching the lowest sum, then only that block is walked again
+ * to find where.
+ */
+template<std::integral T>
+size_t parallel_lowest_valley(std::span<const T> r,
+                              size_t nthreads = std::thread::hardware_concurrency())
+{
+    auto blocks = detail::summarize_blocks(
+        r, nthreads, [](size_t, long, const prefix_summary&) { return false; });
+    prefix_summary total;
+    for (const auto& b : blocks) {
+        total = combine(total, b);
+    }
+
+    long offset = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (offset + blocks[b].min == total.min) {
+            size_t lo = b * detail::SCAN_BLOCK;
+            return lo + first_prefix_at(r.subspan(lo, blocks[b].size),
+                                        total.min, offset);
+        }
+        offset += blocks[b].sum;
+    }
+    return 0;
+}
+
+/*
+ * `non_neg_prefix_sum` across `nthreads` threads.
+ *
+ * still exits early: as soon as every block before a negative prefix sum has
+ * been summarized, the blocks still waiting are cancelled.
+ */
+template<std::integral T>
+bool parallel_non_neg_prefix_sum(
+    std::span<const T> r, size_t nthreads = std::thread::hardware_concurrency())
+{
+    bool negative = false;
+    detail::summarize_blocks(r, nthreads,
+                             [&](size_t, long offset, const prefix_summary& b) {
+                                 negative = b.size > 0 && offset + b.min < 0;
+                                 return negative;
+                             });
+    return !negative;
+}
 
 /*
  * takes any integral range and tests its prefix sums for non-negativity
+ *
+ * takes any input range by forwarding reference, so views that are not
+ * const-iterable (`std::views::filter`) and single-pass sources
+ * (`std::ranges::istream_view`) are consumed lazily, stopping at the first
+ * negative sum without buffering anything.
+ *
+ * contiguous int8 ranges are checked with the vectorized kernel, a chunk at a
+ * time so it can still stop early, and split across threads when long.
  */
 template<std::ranges::input_range R>
     requires std::integral<std::ranges::range_value_t<R>>
-bool non_neg_prefix_sum(const R& r)
+bool non_neg_prefix_sum(R&& r)
 {
     using Int = std::ranges::range_value_t<R>;
-    Int sum = 0;
-    for (const Int& i : r) {
-        sum += i;
-        if (sum < 0) {
-            return false;
+    if constexpr (std::ranges::contiguous_range<R> &&
+                  std::ranges::sized_range<R> && std::same_as<Int, int8_t>) {
+        std::span<const int8_t> s(std::ranges::data(r), std::ranges::size(r));
+        if (s.size() >= PARALLEL_THRESHOLD) {
+            return parallel_non_neg_prefix_sum(s);
         }
+        long sum = 0;
+        for (size_t i = 0; i < s.size(); i += detail::SIMD_CHUNK) {
+            size_t n = std::min(detail::SIMD_CHUNK, s.size() - i);
+            auto chunk = detail::summarize_simd(s.data() + i, n);
+            if (sum + chunk.min < 0) {
+                return false;
+            }
+            sum += chunk.sum;
+        }
+        return true;
+    }
+    else {
+        // at least as wide as the contiguous path, so int8 lists can climb
+        // past 127
+        std::common_type_t<Int, long> sum = 0;
+        for (auto&& i : r) {
+            sum += i;
+            if (sum < 0) {
+                return false;
+            }
+        }
+        return true;
     }
-    return true;
 }
 
 /*
  * Takes any integer iterable and tests its prefix sums for non-positivity
+ *
+ * takes any input range by forwarding reference, as `non_neg_prefix_sum`.
  */
 template<std::ranges::input_range R>
     requires std::integral<std::ranges::range_value_t<R>>
-bool non_pos_prefix_sum(const R& r)
+bool non_pos_prefix_sum(R&& r)
 {
     using Int = std::ranges::range_value_t<R>;
-    Int sum = 0;
-    for (const Int& i : r) {
+    std::common_type_t<Int, long> sum = 0;
+    for (auto&& i : r) {
         sum += i;
         if (sum > 0) {
             return false;
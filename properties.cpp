@@ -0,0 +1,79 @@
+#ifdef TESTING
+#include "doctest.h"
+#include "properties.hpp"
+
+TEST_CASE("exact property distributions")
+{
+    SUBCASE("match enumeration")
+    {
+        size_t n = 9;
+        std::vector<double> height(n + 1), peaks(n + 1), returns(n + 1),
+            first(n + 1);
+        double c = catalan(n);
+        for_each_dyck(
+            n,
+            [&](uint64_t, dyck_word w) {
+                auto st = stats(from_word(w, 2 * n));
+                height[st.max_height] += 1 / c;
+                peaks[st.peaks] += 1 / c;
+                returns[st.returns] += 1 / c;
+                first[st.first_return] += 1 / c;
+            },
+            1);
+
+        auto check = [](const auto& exact, const auto& enumerated) {
+            REQUIRE_EQ(exact.size(), enumerated.size());
+            for (size_t i = 0; i < exact.size(); ++i) {
+                CHECK_EQ(exact[i], doctest::Approx(enumerated[i]));
+            }
+        };
+        check(max_height_distribution(n), height);
+        check(peaks_distribution(n), peaks);
+        check(returns_distribution(n), returns);
+        check(first_return_distribution(n), first);
+    }
+
+    SUBCASE("sum to 1 for large n")
+    {
+        size_t n = 1000;
+        for (const auto& dist :
+             {max_height_distribution(n), peaks_distribution(n),
+              returns_distribution(n), first_return_distribution(n)}) {
+            double sum = 0;
+            for (const auto& p : dist) {
+                sum += p;
+            }
+            CHECK_EQ(sum, doctest::Approx(1.0));
+        }
+    }
+}
+
+TEST_CASE("gamma_q")
+{
+    for (double x : {0.1, 1.0, 3.0, 10.0, 50.0}) {
+        CHECK_EQ(gamma_q(1, x), doctest::Approx(std::exp(-x)));
+        CHECK_EQ(gamma_q(0.5, x), doctest::Approx(std::erfc(std::sqrt(x))));
+    }
+}
+
+TEST_CASE("property_tests")
+{
+    SUBCASE("uniform sampler passes at n=1000")
+    {
+        for (const auto& t : property_tests(1000, 2000)) {
+            INFO(t.name);
+            CHECK_GT(t.p_value, 1e-4);
+        }
+    }
+
+    SUBCASE("biased sampler fails at n=1000")
+    {
+        double worst = 1.0;
+        for (const auto& t : property_tests(1000, 2000, true)) {
+            worst = std::min(worst, t.p_value);
+        }
+        CHECK_LT(worst, 1e-6);
+    }
+}
+
+#endif
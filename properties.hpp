@@ -0,0 +1,251 @@
+#ifndef PROPERTIES_HPP
+#define PROPERTIES_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "analytics.hpp"
+#include "balance.hpp"
+#include "enumerate.hpp"
+
+// validates the sampler for large n without enumerating every list.
+//
+// cheap statistics of each sampled path are compared against their exact
+// distributions over all balanced lists of size n, which are known in closed
+// form (or by a small dynamic program for the height).
+
+// natural log of binom(n, k)
+inline double log_binom(double n, double k)
+{
+    return std::lgamma(n + 1) - std::lgamma(k + 1) - std::lgamma(n - k + 1);
+}
+
+// exact distributions over all balanced lists of size n, indexed by value
+// (index 0 is impossible for n > 0).
+
+// ballot numbers: k/(2n-k) * binom(2n-k, n) lists return to 0 k times
+inline std::vector<double> returns_distribution(size_t n)
+{
+    std::vector<double> p(n + 1, 0.0);
+    for (size_t k = 1; k <= n; ++k) {
+        p[k] = std::exp(std::log(double(k) / (2 * n - k)) +
+                        log_binom(2 * n - k, n) - log_catalan(n));
+    }
+    return p;
+}
+
+// narayana numbers: binom(n, k) binom(n, k-1) / n lists have k peaks
+inline std::vector<double> peaks_distribution(size_t n)
+{
+    std::vector<double> p(n + 1, 0.0);
+    for (size_t k = 1; k <= n; ++k) {
+        p[k] = std::exp(log_binom(n, k) + log_binom(n, k - 1) - std::log(n) -
+                        log_catalan(n));
+    }
+    return p;
+}
+
+// C_{j-1} C_{n-j} lists first return to 0 at index 2j
+inline std::vector<double> first_return_distribution(size_t n)
+{
+    std::vector<double> p(n + 1, 0.0);
+    for (size_t j = 1; j <= n; ++j) {
+        p[j] = std::exp(log_catalan(j - 1) + log_catalan(n - j) -
+                        log_catalan(n));
+    }
+    return p;
+}
+
+// counts the paths that stay within [0, h] by dynamic programming, halving at
+// every step so nothing overflows, then differences the cumulative
+// probabilities.
+//
+// stops once the rest of the distribution is negligible.
+inline std::vector<double> max_height_distribution(size_t n)
+{
+    std::vector<double> p(n + 1, 0.0);
+    const double scale = std::exp(log_catalan(n) - 2.0 * n * std::log(2.0));
+    double prev = 0.0;
+    for (size_t h = 1; h <= n && prev < 1 - 1e-15; ++h) {
+        std::vector<double> cur(h + 2, 0.0), next(h + 2, 0.0);
+        cur[0] = 1.0;
+        for (size_t step = 0; step < 2 * n; ++step) {
+            for (size_t j = 0; j <= h; ++j) {
+                next[j] = 0.5 * ((j > 0 ? cur[j - 1] : 0.0) + cur[j + 1]);
+            }
+            std::swap(cur, next);
+        }
+        double cdf = std::min(cur[0] / scale, 1.0);
+        p[h] = cdf - prev;
+        prev = cdf;
+    }
+    return p;
+}
+
+// regularized upper incomplete gamma function Q(a, x), the chi-square tail.
+//
+// series below a+1, continued fraction above. (numerical recipes 6.2)
+inline double gamma_q(double a, double x)
+{
+    if (x <= 0) {
+        return 1.0;
+    }
+    const double lead = a * std::log(x) - x - std::lgamma(a);
+    if (x < a + 1) {
+        double ap = a, del = 1.0 / a, sum = del;
+        for (int i = 0; i < 1000 && std::abs(del) > std::abs(sum) * 1e-15;
+             ++i) {
+            del *= x / ++ap;
+            sum += del;
+        }
+        return 1.0 - sum * std::exp(lead);
+    }
+    const double tiny = 1e-300;
+    double b = x + 1 - a, c = 1 / tiny, d = 1 / b, f = d;
+    for (int i = 1; i < 1000; ++i) {
+        double an = -i * (i - a);
+        b += 2;
+        d = an * d + b;
+        d = std::abs(d) < tiny ? tiny : d;
+        c = b + an / c;
+        c = std::abs(c) < tiny ? tiny : c;
+        d = 1 / d;
+        double del = d * c;
+        f *= del;
+        if (std::abs(del - 1) < 1e-15) {
+            break;
+        }
+    }
+    return std::exp(lead) * f;
+}
+
+// kolmogorov distribution tail, P(sqrt(m) D > lambda) for large m
+inline double kolmogorov_q(double lambda)
+{
+    if (lambda < 0.2) {
+        return 1.0;
+    }
+    double q = 0.0;
+    for (int j = 1; j <= 100; ++j) {
+        double term = std::exp(-2.0 * j * j * lambda * lambda);
+        q += (j % 2 ? 2 : -2) * term;
+        if (term < 1e-17) {
+            break;
+        }
+    }
+    return std::clamp(q, 0.0, 1.0);
+}
+
+struct property_test {
+    std::string name;
+    double statistic;
+    double p_value;
+};
+
+// pearson's chi-square goodness of fit of `observed` counts against the
+// probabilities `expected`.
+//
+// neighbouring values are merged until each bin expects at least 5, so the
+// long tails don't break the chi-square approximation.
+inline property_test chi_square_test(std::string name,
+                                     const std::vector<size_t>& observed,
+                                     const std::vector<double>& expected)
+{
+    double m = 0;
+    for (const auto& o : observed) {
+        m += o;
+    }
+
+    std::vector<std::pair<double, double>> bins; // {observed, expected}
+    double o = 0, e = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        o += i < observed.size() ? observed[i] : 0;
+        e += expected[i] * m;
+        if (e >= 5) {
+            bins.push_back({o, e});
+            o = e = 0;
+        }
+    }
+    // anything observed outside of `expected` can't happen at all
+    for (size_t i = expected.size(); i < observed.size(); ++i) {
+        o += observed[i];
+    }
+    if (bins.empty()) {
+        bins.push_back({o, e});
+    }
+    else {
+        bins.back().first += o;
+        bins.back().second += e;
+    }
+
+    double chi = 0;
+    for (const auto& [bo, be] : bins) {
+        chi += (bo - be) * (bo - be) / be;
+    }
+    double df = bins.size() - 1.0;
+    double p = df > 0 ? gamma_q(df / 2, chi / 2) : 1.0;
+    return {std::move(name), chi, p};
+}
+
+// kolmogorov-smirnov test of `observed` counts against `expected`.
+//
+// conservative since the statistics are discrete.
+inline property_test ks_test(std::string name,
+                             const std::vector<size_t>& observed,
+                             const std::vector<double>& expected)
+{
+    double m = 0;
+    for (const auto& o : observed) {
+        m += o;
+    }
+    double d = 0, fo = 0, fe = 0;
+    for (size_t i = 0; i < std::max(observed.size(), expected.size()); ++i) {
+        fo += i < observed.size() ? observed[i] / m : 0;
+        fe += i < expected.size() ? expected[i] : 0;
+        d = std::max(d, std::abs(fo - fe));
+    }
+    return {std::move(name), d, kolmogorov_q(std::sqrt(m) * d)};
+}
+
+// samples `m` balanced lists of size `n` and tests their max height, peaks,
+// returns, and first return against the exact distributions.
+//
+// the lists are generated and analyzed in batches.
+inline std::vector<property_test> property_tests(size_t n, size_t m,
+                                                 bool bias = false)
+{
+    constexpr size_t BATCH = 256;
+    std::vector<size_t> height(n + 1), peaks(n + 1), returns(n + 1),
+        first(n + 1);
+
+    const symbols init(n);
+    std::vector<symbols> batch(BATCH);
+    for (size_t done = 0; done < m; done += batch.size()) {
+        batch.resize(std::min(BATCH, m - done));
+        for (auto& s : batch) {
+            s.assign(init.begin(), init.end());
+            s.scramble(bias);
+            s.cut_and_splice();
+        }
+        auto cols = analyze(batch);
+        for (size_t i = 0; i < cols.size(); ++i) {
+            ++height[cols.max_height[i]];
+            ++peaks[cols.peaks[i]];
+            ++returns[cols.returns[i]];
+            ++first[cols.first_return[i]];
+        }
+    }
+
+    auto hdist = max_height_distribution(n);
+    return {
+        chi_square_test("max height", height, hdist),
+        ks_test("max height (ks)", height, hdist),
+        chi_square_test("peaks", peaks, peaks_distribution(n)),
+        chi_square_test("returns", returns, returns_distribution(n)),
+        chi_square_test("first return", first, first_return_distribution(n)),
+    };
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifdef TESTING
+#include <atomic>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "doctest.h"
+#include "prefix.hpp"
+#include "server.hpp"
+
+TEST_CASE("list_server")
+{
+    const std::string path =
+        "/tmp/lab4test_server_" + std::to_string(::getpid());
+    server_options opt;
+    opt.max_n = 1000;
+    opt.max_count = 5000;
+    opt.max_bytes = 1 << 20;
+    opt.pool_bytes = 1 << 10;
+
+    std::atomic<bool> stop{false};
+    list_server server(path, opt);
+    std::thread t([&] { server.run([&] { return stop.load(); }); });
+
+    SUBCASE("balanced lists of the size asked for")
+    {
+        for (size_t n : {1, 4, 7, 100, 4}) {
+            auto lists = request_lists(path, n, 10);
+            REQUIRE_EQ(lists.size(), 10);
+            for (const auto& s : lists) {
+                CHECK_EQ(s.size(), 2 * n);
+                CHECK(non_neg_prefix_sum(s));
+            }
+        }
+    }
+
+    SUBCASE("more than a pool holds")
+    {
+        // 16 lists of n = 1000 fill a pool, the rest are made on the spot
+        auto lists = request_lists(path, 1000, 100);
+        CHECK_EQ(lists.size(), 100);
+        size_t balanced = 0;
+        for (const auto& s : lists) {
+            balanced += non_neg_prefix_sum(s);
+        }
+        CHECK_EQ(balanced, 100);
+        // the pool wraps around and refills underneath
+        for (int i = 0; i < 20; ++i) {
+            CHECK_EQ(request_lists(path, 1000, 7).size(), 7);
+        }
+    }
+
+    SUBCASE("out of bounds requests are refused")
+    {
+        CHECK_THROWS(request_lists(path, 0, 1));
+        CHECK_THROWS(request_lists(path, 1001, 1));
+        CHECK_THROWS(request_lists(path, 4, 5001));
+        // 5000 lists of n = 1000 are more than max_bytes
+        CHECK_THROWS(request_lists(path, 1000, 5000));
+        CHECK_EQ(request_lists(path, 4, 0).size(), 0);
+    }
+
+    SUBCASE("a stalled client doesn't hold up the others")
+    {
+        auto connect = [&] {
+            sockaddr_un addr = detail::socket_address(path);
+            int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            REQUIRE(fd >= 0);
+            REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&addr),
+                              sizeof(addr)) == 0);
+            return fd;
+        };
+        uint8_t req[16];
+        detail::put_le(req, 1000, 8);
+        detail::put_le(req + 8, 4000, 8);
+
+        // half a request, never finished
+        int half = connect();
+        CHECK_EQ(::send(half, req, 8, 0), 8);
+        // a megabyte of answer, never read
+        int deaf = connect();
+        CHECK_EQ(::send(deaf, req, sizeof(req), 0), 16);
+
+        for (int i = 0; i < 5; ++i) {
+            CHECK_EQ(request_lists(path, 1000, 10).size(), 10);
+        }
+        ::close(half);
+        ::close(deaf);
+    }
+
+    stop = true;
+    t.join();
+    CHECK_GT(server.latency().requests, 0);
+    CHECK_LE(server.latency().p50, server.latency().p99);
+}
+
+TEST_CASE("list_pool")
+{
+    // 150 lists of n = 10, refilled in batches that don't divide it
+    const size_t n = 10, record = stream_header{n}.record_size();
+    detail::list_pool pool(n, 150 * record, 7);
+    CHECK(pool.low());
+    pool.refill();
+    CHECK_FALSE(pool.low());
+
+    // the pool, then lists made on the spot, in the generator's order
+    std::vector<uint8_t> out;
+    pool.take(out, 155);
+    REQUIRE_EQ(out.size(), 155 * record);
+    size_t i = 0;
+    for (const auto& s : views::balanced(n, 7) | std::views::take(155)) {
+        symbols got(2 * n, 0);
+        detail::unpack(&out[i++ * record], 0, 2 * n, got.data());
+        CHECK_EQ(got, s);
+    }
+    CHECK(pool.low());
+}
+
+#endif
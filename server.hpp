@@ -0,0 +1,494 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "generate.hpp"
+#include "outofcore.hpp"
+#include "stream.hpp"
+#include "views.hpp"
+
+// a daemon handing out random balanced lists over a unix domain socket.
+//
+// a request is two little-endian uint64s, n and count. the response is the
+// same two numbers followed by `count` lists packed as in a binary stream
+// (stream.hpp), or n = count = 0 if the request can't be served.
+// connections can send any number of requests one after another.
+//
+// every n that has been asked for gets a pool of lists made ahead of time,
+// topped up by a background thread whenever it falls below half full, so a
+// request is usually answered with a copy straight out of a pool.
+//
+// client sockets are non-blocking and each keeps its own half read request
+// and half written answer, so a client that stalls only holds itself up.
+
+struct server_options {
+    uint64_t seed = 0;
+    size_t max_n = 1 << 16;
+    size_t max_count = 1 << 16;
+    size_t max_bytes = 1 << 22; // of lists in one answer
+    size_t max_pools = 64;
+    size_t pool_bytes = 1 << 20; // per pool, at least 16 lists
+};
+
+struct latency_stats {
+    size_t requests = 0;
+    double p50 = 0; // microseconds
+    double p99 = 0;
+};
+
+namespace detail {
+
+// reads or writes all of `n` bytes on a blocking socket. false if the other
+// end went away.
+inline bool recv_all(int fd, void* p, size_t n)
+{
+    auto b = static_cast<uint8_t*>(p);
+    while (n > 0) {
+        ssize_t r = ::recv(fd, b, n, 0);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        b += r;
+        n -= r;
+    }
+    return true;
+}
+
+// writev(2) until every iovec has gone. false if the other end went away.
+inline bool writev_all(int fd, iovec* iov, int cnt)
+{
+    while (cnt > 0) {
+        ssize_t w = ::writev(fd, iov, cnt);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        while (cnt > 0 && size_t(w) >= iov->iov_len) {
+            w -= iov->iov_len;
+            ++iov;
+            --cnt;
+        }
+        if (cnt > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + w;
+            iov->iov_len -= w;
+        }
+    }
+    return true;
+}
+
+inline sockaddr_un socket_address(const std::string& path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error(path + ": socket path too long");
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// a ring of packed lists of size n made ahead of time
+class list_pool {
+public:
+    list_pool(size_t n, size_t bytes, uint64_t seed)
+        : n(n), record(stream_header{n}.record_size()),
+          capacity(std::max<size_t>(16, bytes / record)),
+          data(capacity * record), gen(views::balanced(n, seed)),
+          it(gen.begin())
+    {
+    }
+
+    // true if it has fallen below half full
+    bool low() const
+    {
+        std::lock_guard lock(m);
+        return size < capacity / 2;
+    }
+
+    // tops the pool up. only the refill thread calls this.
+    //
+    // lists are made `BATCH` at a time and each batch goes into the pool as
+    // soon as it is ready, so `take` never waits on the generator for more
+    // than one batch.
+    void refill()
+    {
+        size_t want;
+        {
+            std::lock_guard lock(m);
+            want = capacity - size;
+        }
+        std::vector<uint8_t> fresh(std::min(want, BATCH) * record);
+        while (want > 0) {
+            size_t count = std::min(want, BATCH);
+            make(fresh.data(), count);
+            want -= count;
+
+            std::lock_guard lock(m);
+            for (size_t i = 0; i < count && size < capacity; ++i) {
+                size_t tail = (head + size) % capacity;
+                std::memcpy(&data[tail * record], &fresh[i * record], record);
+                ++size;
+            }
+        }
+    }
+
+    // appends `count` packed lists to `out`, from the pool where it can
+    void take(std::vector<uint8_t>& out, size_t count)
+    {
+        size_t at = out.size();
+        out.resize(at + count * record);
+        uint8_t* p = out.data() + at;
+        size_t from_pool;
+        {
+            std::lock_guard lock(m);
+            from_pool = std::min(count, size);
+            size_t first = std::min(from_pool, capacity - head);
+            std::memcpy(p, &data[head * record], first * record);
+            std::memcpy(p + first * record, &data[0],
+                        (from_pool - first) * record);
+            head = (head + from_pool) % capacity;
+            size -= from_pool;
+        }
+        // anything the pool can't cover is made on the spot, without holding
+        // up its refill
+        if (count > from_pool) {
+            make(p + from_pool * record, count - from_pool);
+        }
+    }
+
+private:
+    static constexpr size_t BATCH = 64;
+
+    // makes `count` packed lists into `out`
+    void make(uint8_t* out, size_t count)
+    {
+        std::lock_guard lock(gen_m);
+        for (size_t i = 0; i < count; ++i, ++it) {
+            const symbols& s = *it;
+            pack(s.data(), s.size(), out + i * record);
+        }
+    }
+
+    const size_t n;
+    const size_t record;
+    const size_t capacity;
+
+    mutable std::mutex m;
+    std::vector<uint8_t> data;
+    size_t head = 0;
+    size_t size = 0;
+
+    std::mutex gen_m;
+    generator<symbols> gen;
+    generator<symbols>::iterator it;
+};
+
+// a client of the server and how far it has got
+struct connection {
+    explicit connection(int fd) : fd(fd) {}
+
+    int fd;
+    uint8_t req[16];
+    size_t got = 0;           // bytes of the request read so far
+    std::vector<uint8_t> out; // the answer, empty while reading a request
+    size_t sent = 0;          // bytes of it written so far
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace detail
+
+class list_server {
+public:
+    // listens on the unix socket `path`, replacing whatever is there
+    list_server(const std::string& path, const server_options& opt = {})
+        : path(path), opt(opt)
+    {
+        sockaddr_un addr = detail::socket_address(path);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw detail::sys_error("socket");
+        }
+        ::unlink(path.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(fd, 64) < 0) {
+            ::close(fd);
+            throw detail::sys_error(path);
+        }
+        refiller = std::thread([this] { refill_loop(); });
+    }
+
+    list_server(const list_server&) = delete;
+    list_server& operator=(const list_server&) = delete;
+
+    ~list_server()
+    {
+        {
+            std::lock_guard lock(pools_m);
+            stopping = true;
+        }
+        wake_refill.notify_all();
+        refiller.join();
+        for (const auto& c : clients) {
+            ::close(c.fd);
+        }
+        ::close(fd);
+        ::unlink(path.c_str());
+    }
+
+    // serves requests until `should_stop()`, which is checked at least
+    // every 100ms
+    template<class F>
+    void run(F should_stop)
+    {
+        std::vector<pollfd> fds;
+        while (!should_stop()) {
+            // a client with an answer to write isn't read from until it's
+            // all gone
+            fds.assign(1, pollfd{fd, POLLIN, 0});
+            for (const auto& c : clients) {
+                short events = c.out.empty() ? POLLIN : POLLOUT;
+                fds.push_back({c.fd, events, 0});
+            }
+            int r = ::poll(fds.data(), fds.size(), 100);
+            if (r < 0 && errno != EINTR) {
+                throw detail::sys_error("poll");
+            }
+            if (r <= 0) {
+                continue;
+            }
+            for (size_t i = 1; i < fds.size(); ++i) {
+                auto& c = clients[i - 1];
+                if (fds[i].revents && !progress(c)) {
+                    ::close(c.fd);
+                    c.fd = -1;
+                }
+            }
+            std::erase_if(clients, [](const auto& c) { return c.fd < 0; });
+            if (fds[0].revents & POLLIN) {
+                int c = ::accept4(fd, nullptr, nullptr,
+                                  SOCK_CLOEXEC | SOCK_NONBLOCK);
+                if (c >= 0) {
+                    clients.emplace_back(c);
+                }
+            }
+        }
+    }
+
+    // server side latency from a request arriving to its answer being
+    // written, over (up to) the last million requests
+    latency_stats latency() const
+    {
+        std::vector<double> s = samples;
+        latency_stats l{requests};
+        if (s.empty()) {
+            return l;
+        }
+        auto at = [&](double q) {
+            auto k = s.begin() + size_t(q * (s.size() - 1));
+            std::nth_element(s.begin(), k, s.end());
+            return *k;
+        };
+        l.p50 = at(0.5);
+        l.p99 = at(0.99);
+        return l;
+    }
+
+private:
+    static constexpr size_t MAX_SAMPLES = 1 << 20;
+
+    // reads as much of a request from `c` as has arrived, answering it once
+    // it's all there, or writes as much of its answer as the socket takes.
+    // false if the client went away.
+    bool progress(detail::connection& c)
+    {
+        if (c.out.empty()) {
+            ssize_t r = ::recv(c.fd, c.req + c.got, sizeof(c.req) - c.got, 0);
+            if (r == 0) {
+                return false;
+            }
+            if (r < 0) {
+                return errno == EINTR || errno == EAGAIN;
+            }
+            c.got += r;
+            if (c.got < sizeof(c.req)) {
+                return true;
+            }
+            c.got = 0;
+            answer(c);
+        }
+        while (c.sent < c.out.size()) {
+            ssize_t w = ::send(c.fd, c.out.data() + c.sent,
+                               c.out.size() - c.sent, MSG_NOSIGNAL);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN;
+            }
+            c.sent += w;
+        }
+        c.out.clear();
+        c.sent = 0;
+
+        std::chrono::duration<double, std::micro> us =
+            std::chrono::steady_clock::now() - c.start;
+        if (samples.size() < MAX_SAMPLES) {
+            samples.push_back(us.count());
+        }
+        else {
+            samples[requests % MAX_SAMPLES] = us.count();
+        }
+        ++requests;
+        return true;
+    }
+
+    // puts the answer to the request `c` has just read in `c.out`
+    void answer(detail::connection& c)
+    {
+        c.start = std::chrono::steady_clock::now();
+        uint64_t n = detail::get_le(c.req, 8);
+        uint64_t count = detail::get_le(c.req + 8, 8);
+
+        auto* pool = find_pool(n, count);
+        if (!pool) {
+            n = count = 0;
+        }
+        c.out.resize(16);
+        detail::put_le(c.out.data(), n, 8);
+        detail::put_le(c.out.data() + 8, count, 8);
+        if (pool) {
+            pool->take(c.out, count);
+            if (pool->low()) {
+                wake_refill.notify_one();
+            }
+        }
+    }
+
+    // the pool for lists of size n, made on first use. null if the request
+    // is out of bounds.
+    detail::list_pool* find_pool(uint64_t n, uint64_t count)
+    {
+        if (n == 0 || n > opt.max_n || count > opt.max_count ||
+            count * stream_header{n}.record_size() > opt.max_bytes) {
+            return nullptr;
+        }
+        std::lock_guard lock(pools_m);
+        auto it = pools.find(n);
+        if (it != pools.end()) {
+            return it->second.get();
+        }
+        if (pools.size() >= opt.max_pools) {
+            return nullptr;
+        }
+        auto& p = pools[n];
+        p = std::make_unique<detail::list_pool>(n, opt.pool_bytes,
+                                                chunk_seed(opt.seed, n));
+        wake_refill.notify_one();
+        return p.get();
+    }
+
+    void refill_loop()
+    {
+        std::unique_lock lock(pools_m);
+        while (!stopping) {
+            std::vector<detail::list_pool*> low;
+            for (auto& [n, p] : pools) {
+                if (p->low()) {
+                    low.push_back(p.get());
+                }
+            }
+            if (low.empty()) {
+                wake_refill.wait_for(lock, std::chrono::milliseconds(100));
+                continue;
+            }
+            // pools are never removed, so these stay valid unlocked
+            lock.unlock();
+            for (auto* p : low) {
+                p->refill();
+            }
+            lock.lock();
+        }
+    }
+
+    std::string path;
+    server_options opt;
+    int fd;
+    std::vector<detail::connection> clients;
+
+    std::mutex pools_m;
+    std::condition_variable wake_refill;
+    std::map<uint64_t, std::unique_ptr<detail::list_pool>> pools;
+    bool stopping = false;
+    std::thread refiller;
+
+    std::vector<double> samples;
+    size_t requests = 0;
+};
+
+// asks the server at `path` for `count` lists of size `n`. throws if it
+// refuses.
+inline std::vector<symbols> request_lists(const std::string& path, size_t n,
+                                          size_t count)
+{
+    sockaddr_un addr = detail::socket_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw detail::sys_error("socket");
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        throw detail::sys_error(path);
+    }
+
+    uint8_t req[16];
+    detail::put_le(req, n, 8);
+    detail::put_le(req + 8, count, 8);
+    iovec iov{req, sizeof(req)};
+    uint8_t hdr[16];
+    bool ok = detail::writev_all(fd, &iov, 1) &&
+              detail::recv_all(fd, hdr, sizeof(hdr));
+    if (!ok || detail::get_le(hdr, 8) != n ||
+        detail::get_le(hdr + 8, 8) != count) {
+        ::close(fd);
+        throw std::runtime_error(path + ": request refused");
+    }
+
+    const size_t record = stream_header{n}.record_size();
+    std::vector<uint8_t> packed(count * record);
+    ok = detail::recv_all(fd, packed.data(), packed.size());
+    ::close(fd);
+    if (!ok) {
+        throw std::runtime_error(path + ": response cut short");
+    }
+    std::vector<symbols> lists(count, symbols(2 * n, 0));
+    for (size_t i = 0; i < count; ++i) {
+        detail::unpack(&packed[i * record], 0, 2 * n, lists[i].data());
+    }
+    return lists;
+}
+
+#endif
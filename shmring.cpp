@@ -0,0 +1,153 @@
+#ifdef TESTING
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "doctest.h"
+#include "shmring.hpp"
+#include "views.hpp"
+
+TEST_CASE("shm_ring")
+{
+    const std::string name = "/lab4test_ring_" + std::to_string(::getpid());
+
+    SUBCASE("fifo, full and empty")
+    {
+        auto ring = shm_ring::create(name, 40, 5);
+        CHECK_EQ(ring.capacity(), 8);
+        CHECK_EQ(ring.record_size(), 10);
+
+        std::vector<uint8_t> rec(10);
+        CHECK_FALSE(ring.try_pop(rec));
+        for (uint8_t i = 0; i < 8; ++i) {
+            rec[0] = i;
+            CHECK(ring.try_push(rec));
+        }
+        CHECK_FALSE(ring.try_push(rec));
+        for (uint8_t i = 0; i < 8; ++i) {
+            REQUIRE(ring.try_pop(rec));
+            CHECK_EQ(rec[0], i);
+        }
+        CHECK_FALSE(ring.try_pop(rec));
+    }
+
+    SUBCASE("batches")
+    {
+        auto ring = shm_ring::create(name, 4, 8);
+        std::vector<uint8_t> recs(12);
+        std::iota(recs.begin(), recs.end(), 0);
+        CHECK_EQ(ring.try_push_n(recs, 5), 5);
+        // only 3 more fit
+        CHECK_EQ(ring.try_push_n(recs, 12), 3);
+        CHECK_EQ(ring.try_push_n(recs, 1), 0);
+
+        std::vector<uint8_t> got(12);
+        CHECK_EQ(ring.try_pop_n(got, 6), 6);
+        CHECK_EQ(std::vector(got.begin(), got.begin() + 6),
+                 std::vector<uint8_t>{0, 1, 2, 3, 4, 0});
+        CHECK_EQ(ring.try_pop_n(got, 12), 2);
+        CHECK_EQ(got[0], 1);
+        CHECK_EQ(got[1], 2);
+        CHECK_EQ(ring.try_pop_n(got, 12), 0);
+        CHECK_EQ(ring.try_pop_n(got, 0), 0);
+    }
+
+    SUBCASE("lists round trip through a second mapping")
+    {
+        auto ring = shm_ring::create(name, 25, 64);
+        auto other = shm_ring::open(name);
+        CHECK_EQ(other.n(), 25);
+        std::vector<symbols> sent;
+        for (const auto& s : views::balanced(25, 4) | std::views::take(50)) {
+            CHECK(ring.push(s));
+            sent.push_back(s);
+        }
+        std::vector<int8_t> got;
+        for (const auto& s : sent) {
+            REQUIRE(other.pop(got));
+            CHECK(std::ranges::equal(got, s));
+        }
+        CHECK_THROWS_AS(ring.push(symbols(3)), std::runtime_error);
+    }
+
+    SUBCASE("many producers and consumers, sleeping when full and empty")
+    {
+        // a tiny ring so everyone has to wait on everyone else
+        auto ring = shm_ring::create(name, 32, 4);
+        constexpr uint64_t PER = 20000;
+        constexpr size_t PRODUCERS = 3, CONSUMERS = 2;
+
+        std::vector<std::thread> threads;
+        std::vector<uint64_t> sums(CONSUMERS, 0), counts(CONSUMERS, 0);
+        for (size_t c = 0; c < CONSUMERS; ++c) {
+            threads.emplace_back([&, c] {
+                auto mine = shm_ring::open(name);
+                std::vector<uint8_t> rec(mine.record_size());
+                while (mine.pop(rec)) {
+                    uint64_t v;
+                    std::memcpy(&v, rec.data(), sizeof(v));
+                    sums[c] += v;
+                    ++counts[c];
+                }
+            });
+        }
+        std::atomic<bool> failed{false};
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < PRODUCERS; ++p) {
+            producers.emplace_back([&, p] {
+                auto mine = shm_ring::open(name);
+                std::vector<uint8_t> rec(mine.record_size());
+                for (uint64_t i = 0; i < PER; ++i) {
+                    uint64_t v = p * PER + i;
+                    std::memcpy(rec.data(), &v, sizeof(v));
+                    if (!mine.push(rec)) {
+                        failed = true;
+                    }
+                }
+            });
+        }
+        for (auto& t : producers) {
+            t.join();
+        }
+        ring.close();
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        CHECK_FALSE(failed);
+        const uint64_t total = PRODUCERS * PER;
+        CHECK_EQ(std::accumulate(counts.begin(), counts.end(), 0ull), total);
+        CHECK_EQ(std::accumulate(sums.begin(), sums.end(), 0ull),
+                 total * (total - 1) / 2);
+    }
+
+    SUBCASE("close wakes sleeping consumers")
+    {
+        auto ring = shm_ring::create(name, 4, 4);
+        bool got = true;
+        std::thread t([&] {
+            std::vector<uint8_t> rec(ring.record_size());
+            got = shm_ring::open(name).pop(rec);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ring.close();
+        t.join();
+        CHECK_FALSE(got);
+        CHECK(ring.closed());
+    }
+
+    SUBCASE("names are exclusive and removed")
+    {
+        {
+            auto ring = shm_ring::create(name, 4, 4);
+            CHECK_THROWS_AS(shm_ring::create(name, 4, 4), std::runtime_error);
+        }
+        CHECK_THROWS_AS(shm_ring::open(name), std::runtime_error);
+    }
+}
+
+#endif
@@ -0,0 +1,403 @@
+#ifndef SHMRING_HPP
+#define SHMRING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "outofcore.hpp"
+
+// a ring of fixed-size records in named POSIX shared memory, so processes on
+// the same machine can pass balanced lists without pipes or copies through
+// the kernel.
+//
+// records are lists of size n packed as in a binary stream (stream.hpp). any
+// number of processes and threads can push and pop at once: it is Vyukov's
+// bounded MPMC queue, where every slot carries a sequence number saying
+// whose turn it is, so a push or pop is one compare-and-swap and a copy.
+//
+// nobody makes a system call unless the ring is empty (or full) and they
+// have to sleep: sleepers wait on a futex and announce themselves, and the
+// other side only wakes them when someone is waiting.
+//
+// everything is in this header so consumers only need to include it.
+
+namespace detail {
+
+constexpr uint64_t RING_MAGIC = 0x474e4952334c4142; // "BAL3RING"
+
+// kept in the first page of the shared memory
+struct ring_header {
+    std::atomic<uint64_t> magic;
+    uint64_t n;
+    uint64_t record_size;
+    uint64_t slot_size;
+    uint64_t capacity;
+
+    alignas(64) std::atomic<uint64_t> enqueue;
+    alignas(64) std::atomic<uint64_t> dequeue;
+
+    // futex words, bumped when something is pushed (popped) while anyone
+    // waits for it
+    alignas(64) std::atomic<uint32_t> pushed;
+    std::atomic<uint32_t> popped;
+    std::atomic<uint32_t> waiting_pop;
+    std::atomic<uint32_t> waiting_push;
+    std::atomic<uint32_t> closed;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+inline void futex_wait(std::atomic<uint32_t>& word, uint32_t seen)
+{
+    // wake up now and then anyway so a closed ring is noticed
+    timespec ts{0, 100'000'000};
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, seen,
+              &ts, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t>& word)
+{
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE,
+              INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace detail
+
+class shm_ring {
+public:
+    // creates the ring `name` (e.g. "/lab4") holding up to `capacity` lists of
+    // size `n`, rounded up to a power of 2. it is removed when this is
+    // destroyed, processes already attached keep their mapping.
+    static shm_ring create(const std::string& name, size_t n, size_t capacity)
+    {
+        if (n == 0 || capacity == 0) {
+            throw std::runtime_error("ring needs a list size and capacity");
+        }
+        capacity = std::bit_ceil(capacity);
+        const size_t record = (2 * n + 7) / 8;
+        const size_t slot = (sizeof(uint64_t) + record + 7) / 8 * 8;
+        const size_t bytes = data_offset() + capacity * slot;
+
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+            throw detail::sys_error(name);
+        }
+        if (::ftruncate(fd, bytes) < 0) {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw detail::sys_error(name);
+        }
+        shm_ring r = [&] {
+            try {
+                return shm_ring(fd, bytes, name);
+            }
+            catch (...) {
+                ::shm_unlink(name.c_str());
+                throw;
+            }
+        }();
+        r.owner = true;
+
+        auto* h = new (r.base) detail::ring_header{};
+        h->n = n;
+        h->record_size = record;
+        h->slot_size = slot;
+        h->capacity = capacity;
+        for (size_t i = 0; i < capacity; ++i) {
+            new (r.seq(i)) std::atomic<uint64_t>(i);
+        }
+        // last, so nobody attaches to a half made ring
+        h->magic.store(detail::RING_MAGIC, std::memory_order_release);
+        return r;
+    }
+
+    // attaches to the existing ring `name`
+    static shm_ring open(const std::string& name)
+    {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            throw detail::sys_error(name);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) < 0) {
+            ::close(fd);
+            throw detail::sys_error(name);
+        }
+        if (size_t(st.st_size) < data_offset()) {
+            ::close(fd);
+            throw std::runtime_error(name + ": not a ring");
+        }
+        shm_ring r(fd, st.st_size, name);
+        if (r.header().magic.load(std::memory_order_acquire) !=
+                detail::RING_MAGIC ||
+            data_offset() + r.capacity() * r.header().slot_size > r.bytes) {
+            throw std::runtime_error(name + ": not a ring");
+        }
+        return r;
+    }
+
+    shm_ring(shm_ring&& o) noexcept
+        : base(std::exchange(o.base, nullptr)), bytes(o.bytes),
+          name(std::move(o.name)), owner(std::exchange(o.owner, false))
+    {
+    }
+    shm_ring& operator=(shm_ring&&) = delete;
+
+    ~shm_ring()
+    {
+        if (base) {
+            ::munmap(base, bytes);
+        }
+        if (owner) {
+            ::shm_unlink(name.c_str());
+        }
+    }
+
+    size_t n() const { return header().n; }
+    size_t record_size() const { return header().record_size; }
+    size_t capacity() const { return header().capacity; }
+
+    // appends one packed record without waiting. false if the ring is full.
+    bool try_push(std::span<const uint8_t> record)
+    {
+        return try_push_n(record, 1) == 1;
+    }
+
+    // takes the oldest record without waiting. false if the ring is empty.
+    bool try_pop(std::span<uint8_t> record) { return try_pop_n(record, 1) == 1; }
+
+    // appends up to `count` packed records stored back to back without
+    // waiting, returning how many fit. much cheaper per record than
+    // `try_push`, as they are claimed all at once.
+    size_t try_push_n(std::span<const uint8_t> records, size_t count)
+    {
+        auto& h = header();
+        size_t done = claim(h.enqueue, 0, count, [&](size_t i, uint64_t pos) {
+            std::memcpy(slot(pos), records.data() + i * record_size(),
+                        record_size());
+            return pos + 1;
+        });
+        if (done > 0) {
+            wake(h.waiting_pop, h.pushed);
+        }
+        return done;
+    }
+
+    // takes up to `count` of the oldest records into `records`, back to back,
+    // without waiting. returns how many there were.
+    size_t try_pop_n(std::span<uint8_t> records, size_t count)
+    {
+        auto& h = header();
+        size_t done = claim(h.dequeue, 1, count, [&](size_t i, uint64_t pos) {
+            std::memcpy(records.data() + i * record_size(), slot(pos),
+                        record_size());
+            return pos + capacity();
+        });
+        if (done > 0) {
+            wake(h.waiting_push, h.popped);
+        }
+        return done;
+    }
+
+    // appends one packed record, sleeping while the ring is full. false if
+    // the ring was closed.
+    bool push(std::span<const uint8_t> record)
+    {
+        auto& h = header();
+        return wait_for(h.waiting_push, h.popped,
+                        [&] { return try_push(record); });
+    }
+
+    // takes the oldest record, sleeping while the ring is empty. false once
+    // the ring is closed and empty.
+    bool pop(std::span<uint8_t> record)
+    {
+        auto& h = header();
+        return wait_for(h.waiting_pop, h.pushed,
+                        [&] { return try_pop(record); }) ||
+               try_pop(record);
+    }
+
+    // packs and pushes a list of size n
+    bool push(std::span<const int8_t> s)
+    {
+        if (s.size() != 2 * n()) {
+            throw std::runtime_error("list is the wrong size for the ring");
+        }
+        packed.resize(record_size());
+        detail::pack(s.data(), s.size(), packed.data());
+        return push(std::span<const uint8_t>(packed));
+    }
+
+    // pops and unpacks a list of size n
+    bool pop(std::vector<int8_t>& s)
+    {
+        packed.resize(record_size());
+        if (!pop(std::span<uint8_t>(packed))) {
+            return false;
+        }
+        s.resize(2 * n());
+        detail::unpack(packed.data(), 0, s.size(), s.data());
+        return true;
+    }
+
+    // tells everyone waiting that nothing more will be pushed
+    void close()
+    {
+        auto& h = header();
+        h.closed.store(1);
+        h.pushed.fetch_add(1);
+        h.popped.fetch_add(1);
+        detail::futex_wake(h.pushed);
+        detail::futex_wake(h.popped);
+    }
+
+    bool closed() const { return header().closed.load() != 0; }
+
+private:
+    shm_ring(int fd, size_t bytes, const std::string& name)
+        : bytes(bytes), name(name)
+    {
+        void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            throw detail::sys_error(name);
+        }
+        base = static_cast<uint8_t*>(p);
+    }
+
+    static constexpr size_t data_offset()
+    {
+        return (sizeof(detail::ring_header) + 63) / 64 * 64;
+    }
+
+    detail::ring_header& header() const
+    {
+        return *reinterpret_cast<detail::ring_header*>(base);
+    }
+
+    std::atomic<uint64_t>* seq(size_t i) const
+    {
+        return reinterpret_cast<std::atomic<uint64_t>*>(
+            base + data_offset() + i * header().slot_size);
+    }
+
+    uint8_t* slot(uint64_t pos) const
+    {
+        return reinterpret_cast<uint8_t*>(seq(pos & (capacity() - 1)) + 1);
+    }
+
+    // claims up to `count` slots from the counter `next` in one go, as many
+    // as are ready: a slot's sequence number is its position plus `lag`.
+    // `use(i, pos)` copies record i and returns the slot's next sequence
+    // number.
+    //
+    // a ready slot can only change hands by moving `next` past it, so once
+    // the compare-and-swap succeeds every slot checked is ours. returns how
+    // many were claimed, 0 if the ring is full (empty).
+    template<class F>
+    size_t claim(std::atomic<uint64_t>& next, uint64_t lag, size_t count,
+                 F use)
+    {
+        count = std::min<uint64_t>(count, capacity());
+        uint64_t pos = next.load(std::memory_order_relaxed);
+        while (count > 0) {
+            size_t k = 0;
+            int64_t diff = 0;
+            for (; k < count; ++k) {
+                auto& s = *seq((pos + k) & (capacity() - 1));
+                diff = int64_t(s.load(std::memory_order_acquire) - pos - k -
+                               lag);
+                if (diff != 0) {
+                    break;
+                }
+            }
+            if (k == 0 && diff < 0) {
+                return 0;
+            }
+            if (k > 0 && next.compare_exchange_weak(
+                             pos, pos + k, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < k; ++i) {
+                    auto& s = *seq((pos + i) & (capacity() - 1));
+                    s.store(use(i, pos + i), std::memory_order_release);
+                }
+                return k;
+            }
+            if (k == 0) {
+                // someone else got there first
+                pos = next.load(std::memory_order_relaxed);
+            }
+        }
+        return 0;
+    }
+
+    // wakes whoever sleeps on `word`, only if someone announced it
+    static void wake(std::atomic<uint32_t>& waiting, std::atomic<uint32_t>& word)
+    {
+        // orders the slot update before reading `waiting`, pairing with the
+        // sleeper announcing itself before its last try
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) > 0) {
+            word.fetch_add(1);
+            detail::futex_wake(word);
+        }
+    }
+
+    // calls `attempt` until it succeeds, sleeping on `word` in between.
+    // false if the ring was closed first.
+    template<class F>
+    bool wait_for(std::atomic<uint32_t>& waiting, std::atomic<uint32_t>& word,
+                  F attempt)
+    {
+        for (;;) {
+            if (attempt()) {
+                return true;
+            }
+            if (closed()) {
+                return false;
+            }
+            uint32_t seen = word.load();
+            waiting.fetch_add(1);
+            // orders the announcement before the last try's reads, the other
+            // half of the fence in `wake`: either the waker sees us waiting
+            // or we see its update
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool done = attempt();
+            if (!done && !closed()) {
+                detail::futex_wait(word, seen);
+            }
+            waiting.fetch_sub(1);
+            if (done) {
+                return true;
+            }
+        }
+    }
+
+    uint8_t* base = nullptr;
+    size_t bytes;
+    std::string name;
+    bool owner = false;
+    std::vector<uint8_t> packed;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifdef TESTING
+#include <filesystem>
+#include <fstream>
+#include <ranges>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "doctest.h"
+#include "stream.hpp"
+#include "views.hpp"
+
+TEST_CASE("binary streams")
+{
+    auto dir = std::filesystem::temp_directory_path();
+    std::string path = dir / "lab4test_stream.bin";
+
+    auto write = [&](const stream_header& h, size_t count) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        REQUIRE(fd >= 0);
+        {
+            // tiny buffer so it flushes many times
+            stream_writer out(fd, h, 40);
+            for (const auto& s :
+                 views::balanced(h.n, h.seed) | std::views::take(count)) {
+                out.write(s);
+            }
+        }
+        ::close(fd);
+    };
+
+    SUBCASE("header round trip")
+    {
+        stream_header h{123, 456, 0xdeadbeefcafef00d, engine::mt19937};
+        uint8_t buf[stream_header::SIZE];
+        encode_header(h, buf);
+        CHECK(is_stream(buf, sizeof(buf)));
+        CHECK_EQ(decode_header(buf, sizeof(buf)), h);
+        CHECK_THROWS_AS(decode_header(buf, sizeof(buf) - 1),
+                        std::runtime_error);
+        buf[0] = '{';
+        CHECK_FALSE(is_stream(buf, sizeof(buf)));
+
+        h.eng = engine::xoshiro256x8;
+        encode_header(h, buf);
+        CHECK_EQ(decode_header(buf, sizeof(buf)).eng, engine::xoshiro256x8);
+    }
+
+    SUBCASE("engine names")
+    {
+        for (engine e : {engine::mt19937, engine::xoshiro256x8}) {
+            CHECK_EQ(engine_from_name(engine_name(e)), e);
+        }
+        CHECK_THROWS_AS(engine_from_name("rand"), std::runtime_error);
+    }
+
+    SUBCASE("lists round trip and repeat from the header")
+    {
+        for (size_t n : {1, 3, 4, 50}) {
+            stream_header h{n, 100, n * 7, engine::mt19937};
+            write(h, h.count);
+            CHECK_EQ(std::filesystem::file_size(path),
+                     stream_header::SIZE + h.count * ((2 * n + 7) / 8));
+
+            input_buffer in(path);
+            stream_reader lists(in);
+            REQUIRE_EQ(lists.header(), h);
+            std::vector<int8_t> s;
+            auto again = views::balanced(h.n, h.seed);
+            auto it = again.begin();
+            size_t k = 0;
+            while (lists.next(s)) {
+                CHECK(std::ranges::equal(s, *it));
+                ++it;
+                ++k;
+            }
+            CHECK_EQ(k, h.count);
+            CHECK_FALSE(lists.truncated());
+        }
+    }
+
+    SUBCASE("unbounded streams end with the input")
+    {
+        stream_header h{5, stream_header::UNBOUNDED, 1, engine::mt19937};
+        write(h, 10);
+        input_buffer in(path);
+        stream_reader lists(in);
+        std::vector<int8_t> s;
+        size_t k = 0;
+        while (lists.next(s)) {
+            ++k;
+        }
+        CHECK_EQ(k, 10);
+        CHECK_FALSE(lists.truncated());
+    }
+
+    SUBCASE("truncated")
+    {
+        stream_header h{20, 10, 1, engine::mt19937};
+        write(h, 10);
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) -
+                                               1);
+        input_buffer in(path);
+        stream_reader lists(in);
+        std::vector<int8_t> s;
+        size_t k = 0;
+        while (lists.next(s)) {
+            ++k;
+        }
+        CHECK_EQ(k, 9);
+        CHECK(lists.truncated());
+    }
+
+    SUBCASE("lists must be 2n long")
+    {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        stream_writer out(fd, stream_header{4, 1, 0, engine::mt19937});
+        CHECK_THROWS_AS(out.write(symbols(4)), std::runtime_error);
+        out.flush();
+        ::close(fd);
+    }
+
+    std::filesystem::remove(path);
+}
+
+#endif
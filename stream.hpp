@@ -0,0 +1,241 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "balance.hpp"
+#include "outofcore.hpp"
+
+// a binary stream of balanced lists, all of size n.
+//
+// a 32 byte header, all little-endian:
+//
+//     0   "BALS"       magic
+//     4   uint16_t     version, 1
+//     6   uint16_t     random engine the lists were made with
+//     8   uint64_t     n
+//     16  uint64_t     number of lists, or UNBOUNDED if not known up front
+//     24  uint64_t     seed
+//
+// then each list as 2n bits, packed as in outofcore.hpp, padded to a whole
+// byte so list i is at a fixed offset. 1 bit per symbol rather than the 4
+// or so bytes `operator<<` prints.
+
+// random engines lists can be made with, so a run can be repeated from its
+// header
+enum class engine : uint16_t {
+    mt19937 = 0,      // as `views::balanced`
+    xoshiro256x8 = 1, // xoshiro.hpp
+};
+
+inline const char* engine_name(engine e)
+{
+    switch (e) {
+    case engine::mt19937:
+        return "mt19937";
+    case engine::xoshiro256x8:
+        return "xoshiro256x8";
+    }
+    return "unknown";
+}
+
+// throws if `name` isn't one of the engines
+inline engine engine_from_name(std::string_view name)
+{
+    for (auto e : {engine::mt19937, engine::xoshiro256x8}) {
+        if (name == engine_name(e)) {
+            return e;
+        }
+    }
+    throw std::runtime_error("unknown random engine " + std::string(name));
+}
+
+struct stream_header {
+    static constexpr size_t SIZE = 32;
+    static constexpr uint16_t VERSION = 1;
+    static constexpr uint64_t UNBOUNDED = std::numeric_limits<uint64_t>::max();
+
+    uint64_t n = 0;
+    uint64_t count = UNBOUNDED;
+    uint64_t seed = 0;
+    engine eng = engine::mt19937;
+
+    // bytes per list
+    size_t record_size() const { return (2 * n + 7) / 8; }
+
+    bool operator==(const stream_header&) const = default;
+};
+
+namespace detail {
+
+constexpr char STREAM_MAGIC[4] = {'B', 'A', 'L', 'S'};
+
+} // namespace detail
+
+// true if [p, p + size) starts with a stream header.
+//
+// other formats with the same header (archive.hpp) pass their own `magic`.
+inline bool is_stream(const uint8_t* p, size_t size,
+                      const char* magic = detail::STREAM_MAGIC)
+{
+    return size >= sizeof(detail::STREAM_MAGIC) &&
+           std::memcmp(p, magic, sizeof(detail::STREAM_MAGIC)) == 0;
+}
+
+inline void encode_header(const stream_header& h, uint8_t* out,
+                          const char* magic = detail::STREAM_MAGIC)
+{
+    std::memcpy(out, magic, sizeof(detail::STREAM_MAGIC));
+    detail::put_le(out + 4, stream_header::VERSION, 2);
+    detail::put_le(out + 6, uint16_t(h.eng), 2);
+    detail::put_le(out + 8, h.n, 8);
+    detail::put_le(out + 16, h.count, 8);
+    detail::put_le(out + 24, h.seed, 8);
+}
+
+// throws if it isn't a header this version understands
+inline stream_header decode_header(const uint8_t* p, size_t size,
+                                   const char* magic = detail::STREAM_MAGIC)
+{
+    if (size < stream_header::SIZE || !is_stream(p, size, magic)) {
+        throw std::runtime_error("not a balanced list stream");
+    }
+    if (detail::get_le(p + 4, 2) != stream_header::VERSION) {
+        throw std::runtime_error("unknown stream version");
+    }
+    stream_header h;
+    h.eng = engine(detail::get_le(p + 6, 2));
+    h.n = detail::get_le(p + 8, 8);
+    h.count = detail::get_le(p + 16, 8);
+    h.seed = detail::get_le(p + 24, 8);
+    if (h.n == 0) {
+        throw std::runtime_error("stream of empty lists");
+    }
+    return h;
+}
+
+// packs lists into a large buffer, written out with one write(2) per
+// `bufsize` bytes.
+class stream_writer {
+public:
+    stream_writer(int fd, const stream_header& h, size_t bufsize = 1 << 20)
+        : fd(fd), h(h), buf(std::max(bufsize, stream_header::SIZE))
+    {
+        if (h.n == 0) {
+            throw std::runtime_error("stream of empty lists");
+        }
+        encode_header(h, buf.data());
+        used = stream_header::SIZE;
+    }
+
+    stream_writer(const stream_writer&) = delete;
+    stream_writer& operator=(const stream_writer&) = delete;
+
+    ~stream_writer()
+    {
+        try {
+            flush();
+        }
+        catch (...) {
+            // nowhere to report it, call flush() first to find out
+        }
+    }
+
+    // appends one list, which must be of size 2n
+    void write(std::span<const int8_t> s)
+    {
+        if (s.size() != 2 * h.n) {
+            throw std::runtime_error("list is the wrong size for the stream");
+        }
+        if (used + h.record_size() > buf.size()) {
+            flush();
+            if (h.record_size() > buf.size()) {
+                buf.resize(h.record_size());
+            }
+        }
+        detail::pack(s.data(), s.size(), buf.data() + used);
+        used += h.record_size();
+        ++written;
+    }
+
+    void flush()
+    {
+        detail::write_all(fd, buf.data(), used);
+        used = 0;
+    }
+
+    const stream_header& header() const { return h; }
+    size_t count() const { return written; }
+
+private:
+    int fd;
+    stream_header h;
+    std::vector<uint8_t> buf;
+    size_t used = 0;
+    size_t written = 0;
+};
+
+// reads the lists back out of a stream, from a mapped file or standard input.
+class stream_reader {
+public:
+    // reads the header, throwing if there isn't one
+    explicit stream_reader(input_buffer& in) : in(in)
+    {
+        fill(stream_header::SIZE);
+        h = decode_header(in.data(), in.size());
+        in.consume(stream_header::SIZE);
+    }
+
+    const stream_header& header() const { return h; }
+
+    // unpacks the next list into `s`. false at the end of the stream, or if
+    // it stops part way through a list (see `truncated`).
+    bool next(std::vector<int8_t>& s)
+    {
+        const size_t rs = h.record_size();
+        if (read == h.count) {
+            return false;
+        }
+        if (!fill(rs)) {
+            cut = in.size() > 0 || h.count != stream_header::UNBOUNDED;
+            return false;
+        }
+        s.resize(2 * h.n);
+        detail::unpack(in.data(), 0, s.size(), s.data());
+        in.consume(rs);
+        ++read;
+        return true;
+    }
+
+    // true if the stream ended before the header said it would, or part way
+    // through a list
+    bool truncated() const { return cut; }
+
+private:
+    // reads until at least `want` bytes are buffered. false if there aren't
+    // that many left.
+    bool fill(size_t want)
+    {
+        while (in.size() < want) {
+            if (!in.more()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    input_buffer& in;
+    stream_header h;
+    uint64_t read = 0;
+    bool cut = false;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifdef TESTING
+#include <random>
+
+#include "doctest.h"
+#include "table.hpp"
+
+TEST_CASE("freq_table")
+{
+    const size_t catalan_of_7 = 429;
+    freq_table table;
+    const symbols a = {1, -1}, b = {1, 1, -1, -1}, c = {1, -1, 1, -1};
+
+    // a: 3, b: 2, c: 1
+    for (const auto& s : {a, a, a, b, b, c}) {
+        table.add(s);
+    }
+
+    SUBCASE("counts")
+    {
+        CHECK_EQ(table.size(), 3);
+        CHECK_EQ(table.total(), 6);
+        CHECK_EQ(table.count(a), 3);
+        CHECK_EQ(table.count(b), 2);
+        CHECK_EQ(table.count(symbols{1, 1, 1, -1, -1, -1}), 0);
+    }
+
+    SUBCASE("counts of counts")
+    {
+        CHECK_EQ(table.counts().size(), 3);
+        CHECK_EQ(table.lists_with_count(3), 1);
+        CHECK_EQ(table.singletons(), 1);
+        CHECK_EQ(table.doubletons(), 1);
+        CHECK_EQ(table.spread(), std::pair{1, 3});
+
+        // c catches up to b, emptying the singleton bucket
+        table.add(c);
+        CHECK_EQ(table.singletons(), 0);
+        CHECK_EQ(table.doubletons(), 2);
+        CHECK_EQ(table.counts().size(), 2);
+    }
+
+    SUBCASE("freq_stddev matches stddev of the frequencies")
+    {
+        // freqs 1/2, 1/3, 1/6, mean 1/3
+        double var = (1.0 / 36 + 0 + 1.0 / 36) / 2;
+        CHECK_EQ(table.freq_stddev(), doctest::Approx(std::sqrt(var)));
+    }
+
+    SUBCASE("estimators")
+    {
+        CHECK_EQ(table.coverage(), doctest::Approx(5.0 / 6));
+        CHECK_EQ(table.chao1(), doctest::Approx(3.5));
+        auto [lo, hi] = table.chao1_ci();
+        CHECK_GE(lo, table.size());
+        CHECK_LT(lo, table.chao1());
+        CHECK_GT(hi, table.chao1());
+        // expected 2 per cell over 3 cells: (1 + 0 + 1) / 2
+        CHECK_EQ(table.chi_square(3), doctest::Approx(1.0));
+        // plus a fourth, never seen, cell expecting 1.5
+        CHECK_EQ(table.chi_square(4),
+                 doctest::Approx((2.25 + 0.25 + 0.25) / 1.5 + 1.5));
+    }
+
+    SUBCASE("chao1 estimates the number of lists")
+    {
+        // 4 samples per list on average, so almost all have been seen.
+        // its own engine, so the bound doesn't depend on the tests before
+        std::mt19937 g;
+        freq_table big;
+        size_t n = 7;
+        for (auto& s : symbols::generate_n(n, 4 * catalan_of_7)) {
+            s.scramble(g);
+            s.cut_and_splice();
+            big.add(s);
+        }
+        auto [lo, hi] = big.chao1_ci();
+        CHECK_LE(lo, catalan_of_7);
+        CHECK_GE(hi, catalan_of_7);
+        CHECK_LT((hi - lo) / big.chao1(), 0.05);
+    }
+
+    SUBCASE("clear")
+    {
+        table.clear();
+        CHECK(table.empty());
+        CHECK(table.counts().empty());
+        CHECK_EQ(table.total(), 0);
+    }
+}
+
+#endif
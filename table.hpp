@@ -0,0 +1,171 @@
+#ifndef TABLE_HPP
+#define TABLE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <utility>
+
+#include "balance.hpp"
+
+// table of unique balanced lists and their number of occurences.
+//
+// alongside the table it keeps the counts-of-counts: how many lists have been
+// seen exactly k times. the counts cluster on a few values (around
+// nsyms / C_n) so statistics over the frequencies only need to walk tens of
+// buckets instead of every list.
+//
+// the lists kept as keys, and the nodes holding them, come from a pool
+// rather than one global new each.
+class freq_table {
+public:
+    using map_type = std::pmr::unordered_map<symbols, int>;
+    using hist_type = std::pmr::unordered_map<int, size_t>;
+
+    // the pool gets its memory from `upstream` in large blocks
+    explicit freq_table(
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : pool(std::make_unique<std::pmr::unsynchronized_pool_resource>(
+              upstream)),
+          table(pool.get()), hist(pool.get())
+    {
+    }
+
+    // adds one occurence of `s`. O(1)
+    void add(const symbols& s)
+    {
+        auto [kv, ins] = table.try_emplace(s, 0);
+        int& v = kv->second;
+        if (v > 0) {
+            auto old = hist.find(v);
+            if (--old->second == 0) {
+                hist.erase(old);
+            }
+        }
+        ++hist[++v];
+        ++nsyms;
+    }
+
+    void clear()
+    {
+        table.clear();
+        hist.clear();
+        nsyms = 0;
+    }
+
+    // number of unique lists
+    size_t size() const { return table.size(); }
+    bool empty() const { return table.empty(); }
+
+    // number of lists added in total
+    long total() const { return nsyms; }
+
+    map_type::const_iterator begin() const { return table.begin(); }
+    map_type::const_iterator end() const { return table.end(); }
+
+    // number of occurences of `s`
+    int count(const symbols& s) const
+    {
+        auto it = table.find(s);
+        return it == table.end() ? 0 : it->second;
+    }
+
+    // maps k to the number of lists seen exactly k times
+    const hist_type& counts() const { return hist; }
+
+    // number of lists seen exactly `k` times
+    size_t lists_with_count(int k) const
+    {
+        auto it = hist.find(k);
+        return it == hist.end() ? 0 : it->second;
+    }
+
+    size_t singletons() const { return lists_with_count(1); }
+    size_t doubletons() const { return lists_with_count(2); }
+
+    // the lowest and highest count of any list
+    std::pair<int, int> spread() const
+    {
+        if (hist.empty()) {
+            return {0, 0};
+        }
+        auto [lo, hi] = std::ranges::minmax(hist | std::views::keys);
+        return {lo, hi};
+    }
+
+    // sample standard deviation of the frequencies (count / total) of the
+    // unique lists.
+    double freq_stddev() const
+    {
+        double mean = 1.0 / size();
+        double sq = 0.0;
+        for (const auto& [k, m] : hist) {
+            double d = double(k) / nsyms - mean;
+            sq += m * d * d;
+        }
+        return std::sqrt(sq / (size() - 1));
+    }
+
+    // pearson's chi-square statistic of the counts against a uniform
+    // distribution over `cells` lists, including the ones never seen.
+    double chi_square(double cells) const
+    {
+        double expect = nsyms / cells;
+        double chi = (cells - size()) * expect;
+        for (const auto& [k, m] : hist) {
+            chi += m * (k - expect) * (k - expect) / expect;
+        }
+        return chi;
+    }
+
+    // good-turing estimate of the sample coverage: the probability that the
+    // next list is one already in the table.
+    double coverage() const
+    {
+        return nsyms == 0 ? 0.0 : 1.0 - double(singletons()) / nsyms;
+    }
+
+    // chao1 lower-bound estimate of the total number of unique lists, seen or
+    // not. (bias-corrected form when there are no doubletons)
+    double chao1() const
+    {
+        double f1 = singletons(), f2 = doubletons();
+        if (f2 > 0) {
+            return size() + f1 * f1 / (2 * f2);
+        }
+        return size() + f1 * (f1 - 1) / 2;
+    }
+
+    // approximate confidence interval of `chao1`, `z` standard deviations
+    // wide, using chao's variance and a log-normal interval so the bounds
+    // never drop below the number of lists already seen.
+    //
+    // unbounded while there are singletons but no doubletons.
+    std::pair<double, double> chao1_ci(double z = 1.96) const
+    {
+        double s = size(), f1 = singletons(), f2 = doubletons();
+        double unseen = chao1() - s;
+        if (unseen <= 0) {
+            return {s, s};
+        }
+        if (f2 == 0) {
+            return {s, INFINITY};
+        }
+        double r = f1 / f2;
+        double var = f2 * (r * r * r * r / 4 + r * r * r + r * r / 2);
+        double c =
+            std::exp(z * std::sqrt(std::log(1 + var / (unseen * unseen))));
+        return {s + unseen / c, s + unseen * c};
+    }
+
+private:
+    // behind a pointer so a moved table still finds it
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> pool;
+    map_type table;
+    hist_type hist;
+    long nsyms = 0;
+};
+
+#endif
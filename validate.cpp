@@ -0,0 +1,182 @@
+#ifdef TESTING
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "doctest.h"
+#include "validate.hpp"
+#include "views.hpp"
+
+namespace {
+
+struct collect {
+    std::vector<std::pair<size_t, bool>>* out;
+    void operator()(size_t, size_t len, bool ok) { out->push_back({len, ok}); }
+};
+
+} // namespace
+
+TEST_CASE("validate_input")
+{
+    auto dir = std::filesystem::temp_directory_path();
+    std::string path = dir / "lab4test_validate";
+    std::vector<std::pair<size_t, bool>> got;
+
+    SUBCASE("text, as printed by operator<<")
+    {
+        std::vector<symbols> syms;
+        std::ostringstream os;
+        for (size_t i = 0; i < 20; ++i) {
+            symbols s(i);
+            s.scramble();
+            if (i % 2) {
+                s.cut_and_splice();
+            }
+            syms.push_back(s);
+            os << s << '\n';
+        }
+        std::ofstream(path) << os.str();
+
+        input_buffer in(path);
+        auto totals = validate_input(in, collect{&got});
+        REQUIRE_EQ(totals.records, syms.size());
+        CHECK_EQ(totals.malformed, 0);
+        for (size_t i = 0; i < syms.size(); ++i) {
+            CHECK_EQ(got[i].first, syms[i].size());
+            CHECK_EQ(got[i].second, syms[i].is_balanced());
+        }
+    }
+
+    SUBCASE("malformed text")
+    {
+        std::ofstream(path) << "{1, -1}\n{1, 2, -1}\nnonsense\n{1, -1, -1\n";
+        input_buffer in(path);
+        auto totals = validate_input(in, collect{&got});
+        CHECK_EQ(totals.records, 4);
+        CHECK_EQ(totals.balanced, 1);
+        CHECK_EQ(totals.malformed, 3);
+    }
+
+    SUBCASE("an unterminated list takes nothing after it")
+    {
+        std::ofstream(path) << "{1, -1\n{1, -1}\n{1, -{1, 1, -1, -1}\n";
+        input_buffer in(path);
+        auto totals = validate_input(in, collect{&got});
+        CHECK_EQ(totals.records, 4);
+        CHECK_EQ(totals.balanced, 2);
+        CHECK_EQ(totals.malformed, 2);
+        CHECK_EQ(got[3].first, 4);
+    }
+
+    SUBCASE("binary")
+    {
+        std::vector<symbols> syms;
+        std::ofstream f(path, std::ios::binary);
+        for (size_t i = 0; i < 20; ++i) {
+            symbols s(3 * i);
+            s.scramble();
+            if (i % 3) {
+                s.cut_and_splice();
+            }
+            syms.push_back(s);
+            write_packed(path + ".one", s);
+            std::ifstream one(path + ".one", std::ios::binary);
+            f << one.rdbuf();
+        }
+        f.close();
+        std::filesystem::remove(path + ".one");
+
+        input_buffer in(path);
+        auto totals = validate_input(in, collect{&got});
+        REQUIRE_EQ(totals.records, syms.size());
+        for (size_t i = 0; i < syms.size(); ++i) {
+            CHECK_EQ(got[i].first, syms[i].size());
+            CHECK_EQ(got[i].second, syms[i].is_balanced());
+        }
+    }
+
+    SUBCASE("binary, with a length that looks like text")
+    {
+        // lengths 10 and 32 start with '\n' and ' ', 9 and 13 with '\t' and
+        // '\r', 123 with '{'
+        std::vector<symbols> syms;
+        for (size_t n : {5, 16}) {
+            for (const auto& s : views::balanced(n, 1) | std::views::take(1)) {
+                syms.push_back(s);
+            }
+        }
+        for (size_t n : {4, 6, 61}) {
+            syms.push_back(symbols(n));
+        }
+        for (const auto& first : syms) {
+            std::ofstream f(path, std::ios::binary);
+            const symbols& last = syms.back();
+            for (const symbols* s : {&first, &last, &first}) {
+                write_packed(path + ".one", *s);
+                std::ifstream one(path + ".one", std::ios::binary);
+                f << one.rdbuf();
+            }
+            f.close();
+            std::filesystem::remove(path + ".one");
+
+            got.clear();
+            input_buffer in(path);
+            auto totals = validate_input(in, collect{&got});
+            REQUIRE_EQ(totals.records, 3);
+            CHECK_EQ(totals.malformed, 0);
+            CHECK_EQ(got[0].first, first.size());
+            CHECK_EQ(got[0].second, first.is_balanced());
+            CHECK_EQ(got[1].first, 123);
+        }
+    }
+
+    SUBCASE("binary stream")
+    {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        REQUIRE(fd >= 0);
+        {
+            stream_writer out(fd, stream_header{9, 50, 3, engine::mt19937});
+            for (const auto& s : views::balanced(9, 3) | std::views::take(50)) {
+                out.write(s);
+            }
+        }
+        ::close(fd);
+
+        input_buffer in(path);
+        auto totals = validate_input(in, collect{&got});
+        CHECK_EQ(totals.records, 50);
+        CHECK_EQ(totals.balanced, 50);
+        CHECK_EQ(totals.malformed, 0);
+        CHECK_EQ(got.front().first, 18);
+    }
+
+    SUBCASE("binary, with a bogus length")
+    {
+        // a length near 2^64 must not wrap past the bytes that are left
+        symbols s(4);
+        write_packed(path, s);
+        std::ofstream(path, std::ios::binary | std::ios::app)
+            << std::string(8, '\xff') << "abc";
+
+        input_buffer in(path);
+        auto totals = validate_input(in, collect{&got});
+        REQUIRE_EQ(totals.records, 2);
+        CHECK_EQ(totals.malformed, 1);
+        CHECK_EQ(got[0], std::pair<size_t, bool>(9, false));
+        CHECK_EQ(got[1], std::pair<size_t, bool>(0, false));
+    }
+
+    SUBCASE("empty")
+    {
+        std::ofstream(path) << "\n\n";
+        input_buffer in(path);
+        CHECK_EQ(validate_input(in, collect{&got}).records, 0);
+    }
+
+    std::filesystem::remove(path);
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef VALIDATE_HPP
+#define VALIDATE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "outofcore.hpp"
+#include "prefix.hpp"
+#include "stream.hpp"
+
+// checks many candidate lists at once for a non-negative prefix sum.
+//
+// input is either text, one list per `{1, -1, ...}` as `operator<<` prints
+// them, a binary stream (see stream.hpp), or binary, packed sequence records
+// (see outofcore.hpp) back to back. streams are recognized by their header,
+// otherwise text by its first byte being a '{' or blank with no NUL in the
+// first 8 bytes, which the length of a packed record always has.
+
+struct validate_totals {
+    size_t records = 0;
+    size_t balanced = 0;
+    size_t malformed = 0; // symbols other than 1 and -1, or bad syntax
+};
+
+namespace detail {
+
+inline bool is_blank(uint8_t c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+// tries to parse one `{...}` list from [p, end) into `rec`.
+//
+// returns the number of bytes used, or 0 if the list isn't all there yet.
+// `bad` is set if it isn't a list of 1s and -1s. a list missing its '}' ends
+// at the end of the line or the next '{', so it takes nothing after it.
+inline size_t parse_text(const uint8_t* p, const uint8_t* end,
+                         std::vector<int8_t>& rec, bool& bad)
+{
+    const uint8_t* start = p;
+    rec.clear();
+    bad = false;
+    while (p < end && is_blank(*p)) {
+        ++p;
+    }
+    if (p == end) {
+        return 0;
+    }
+    if (*p++ != '{') {
+        // skip to the next line so one bad record doesn't stop everything
+        bad = true;
+        while (p < end && *p != '\n') {
+            ++p;
+        }
+        return p < end ? p + 1 - start : 0;
+    }
+    while (p < end) {
+        uint8_t c = *p;
+        if (c == '}') {
+            return p + 1 - start;
+        }
+        if (c == '\n' || c == '{') {
+            bad = true;
+            return p + (c == '\n') - start;
+        }
+        if (c == ',' || is_blank(c)) {
+            ++p;
+            continue;
+        }
+        bool neg = c == '-';
+        p += neg;
+        long v = 0;
+        const uint8_t* digits = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            v = v * 10 + (*p++ - '0');
+        }
+        if (p == end) {
+            return 0;
+        }
+        if (p == digits) {
+            bad = true;
+            p += *p != '\n' && *p != '{';
+            continue;
+        }
+        v = neg ? -v : v;
+        if (v != 1 && v != -1) {
+            bad = true;
+        }
+        rec.push_back(v < 0 ? -1 : 1);
+    }
+    return 0;
+}
+
+} // namespace detail
+
+// validates every list in `in`, calling `f(index, length, balanced)` for each.
+//
+// each list is unpacked into a reused buffer and checked with the vectorized
+// `non_neg_prefix_sum`.
+template<class F>
+validate_totals validate_input(input_buffer& in, F f)
+{
+    validate_totals totals;
+    std::vector<int8_t> rec;
+
+    auto report = [&](bool bad) {
+        bool ok = !bad && non_neg_prefix_sum(rec);
+        totals.balanced += ok;
+        totals.malformed += bad;
+        f(totals.records++, rec.size(), ok);
+    };
+
+    while (in.size() < stream_header::SIZE) {
+        if (!in.more()) {
+            break;
+        }
+    }
+    if (is_stream(in.data(), in.size())) {
+        stream_reader lists(in);
+        while (lists.next(rec)) {
+            report(false);
+        }
+        if (lists.truncated()) {
+            rec.clear();
+            report(true);
+        }
+        return totals;
+    }
+
+    // otherwise find out the format from the first bytes, consuming nothing:
+    // a packed record's length can start with a '{' or a blank too
+    if (in.size() == 0) {
+        return totals;
+    }
+    const uint8_t* head = in.data();
+    size_t peek = std::min<size_t>(in.size(), sizeof(uint64_t));
+    bool text = (*head == '{' || detail::is_blank(*head)) &&
+                std::memchr(head, 0, peek) == nullptr;
+
+    for (;;) {
+        if (text) {
+            bool bad;
+            size_t used = detail::parse_text(in.data(), in.data() + in.size(),
+                                             rec, bad);
+            if (used == 0) {
+                if (in.more()) {
+                    continue;
+                }
+                // whatever is left is an unterminated record, or blank
+                while (in.size() > 0 && detail::is_blank(*in.data())) {
+                    in.consume(1);
+                }
+                if (in.size() > 0) {
+                    rec.clear();
+                    report(true);
+                }
+                break;
+            }
+            in.consume(used);
+            report(bad);
+        }
+        else {
+            uint64_t len;
+            if (in.size() < sizeof(len)) {
+                if (in.more()) {
+                    continue;
+                }
+                if (in.size() > 0) {
+                    rec.clear();
+                    report(true);
+                }
+                break;
+            }
+            // compared in bits, as (len + 7) / 8 wraps for a bogus len
+            // near 2^64
+            len = detail::get_le(in.data(), sizeof(len));
+            if (len > (in.size() - sizeof(len)) * 8) {
+                if (in.more()) {
+                    continue;
+                }
+                rec.clear();
+                report(true);
+                break;
+            }
+            rec.resize(len);
+            detail::unpack(in.data() + sizeof(len), 0, len, rec.data());
+            in.consume(sizeof(len) + (len + 7) / 8);
+            report(false);
+        }
+    }
+    return totals;
+}
+
+#endif
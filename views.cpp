@@ -0,0 +1,84 @@
+#ifdef TESTING
+
+#include <algorithm>
+#include <ranges>
+#include <vector>
+
+#include "views.hpp"
+
+#include "doctest.h"
+
+TEST_CASE("views::balanced")
+{
+    SUBCASE("every list is balanced and the right size")
+    {
+        size_t k = 0;
+        for (const auto& s : views::balanced(10, 1) | std::views::take(200)) {
+            CHECK_EQ(s.size(), 20);
+            CHECK(s.is_balanced());
+            ++k;
+        }
+        CHECK_EQ(k, 200);
+    }
+
+    SUBCASE("the same seed gives the same lists")
+    {
+        auto take = [](uint64_t seed) {
+            std::vector<symbols> out;
+            for (const auto& s :
+                 views::balanced(12, seed) | std::views::take(50)) {
+                out.push_back(s);
+            }
+            return out;
+        };
+        CHECK_EQ(take(7), take(7));
+        CHECK_NE(take(7), take(8));
+    }
+
+    SUBCASE("any engine")
+    {
+        auto take = [](auto&& lists) {
+            std::vector<symbols> out;
+            for (const auto& s : std::move(lists) | std::views::take(50)) {
+                out.push_back(s);
+            }
+            return out;
+        };
+        auto xs = take(views::balanced(12, 7, engine::xoshiro256x8));
+        CHECK_EQ(xs, take(views::balanced(12, xoshiro256x8(7))));
+        CHECK_NE(xs, take(views::balanced(12, 7, engine::mt19937)));
+        CHECK_EQ(take(views::balanced(12, 7, engine::mt19937)),
+                 take(views::balanced(12, 7)));
+        CHECK_THROWS_AS(views::balanced(12, 7, engine(9)), std::runtime_error);
+    }
+
+    SUBCASE("composes with filters")
+    {
+        // lists that never touch 0 before the end
+        auto primes = views::balanced(8, 3) |
+                      std::views::filter([](const symbols& s) {
+                          return non_neg_prefix_sum(
+                              s | std::views::take(s.size() - 1) |
+                              std::views::drop(1));
+                      }) |
+                      std::views::take(20);
+        size_t k = 0;
+        for (const auto& s : primes) {
+            CHECK_EQ(s.front(), 1);
+            CHECK_EQ(s[1], 1);
+            ++k;
+        }
+        CHECK_EQ(k, 20);
+    }
+
+    SUBCASE("flattens into one long balanced stream")
+    {
+        // balanced lists back to back are balanced
+        CHECK(non_neg_prefix_sum(views::balanced(30, 5) |
+                                 std::views::take(100) | std::views::join));
+        CHECK_FALSE(non_pos_prefix_sum(views::balanced(30, 5) |
+                                       std::views::take(1) | std::views::join));
+    }
+}
+
+#endif
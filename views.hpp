@@ -0,0 +1,74 @@
+#ifndef VIEWS_HPP
+#define VIEWS_HPP
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+#include "balance.hpp"
+#include "generator.hpp"
+#include "stream.hpp"
+#include "xoshiro.hpp"
+
+namespace views {
+
+namespace detail {
+
+// the engine is held through a pointer: gcc doesn't over-align coroutine
+// frames, and `xoshiro256x8`'s vectors need 64 byte alignment
+template<std::uniform_random_bit_generator G>
+generator<symbols> balanced(size_t n, std::unique_ptr<G> rng, bool bias)
+{
+    const symbols init(n);
+    symbols s;
+    s.reserve(init.size());
+    for (;;) {
+        s.assign(init.begin(), init.end());
+        s.scramble(*rng, bias);
+        s.cut_and_splice();
+        co_yield s;
+    }
+}
+
+} // namespace detail
+
+// an endless stream of random balanced lists of size `n`, made on demand.
+//
+// only one list is held at a time, so memory use is constant however many
+// are taken. each element is only valid until the next is made, copy it to
+// keep it.
+//
+// the same `seed` always gives the same lists.
+//
+//     for (const auto& s : views::balanced(n, seed) | std::views::take(k))
+template<std::uniform_random_bit_generator G>
+generator<symbols> balanced(size_t n, const G& rng, bool bias = false)
+{
+    return detail::balanced(n, std::make_unique<G>(rng), bias);
+}
+
+// as above, drawing from `std::mt19937` seeded with `seed`
+inline generator<symbols> balanced(size_t n, uint64_t seed, bool bias = false)
+{
+    std::seed_seq seq{uint32_t(seed), uint32_t(seed >> 32)};
+    return detail::balanced(n, std::make_unique<std::mt19937>(seq), bias);
+}
+
+// as above, drawing from the engine a stream header names
+inline generator<symbols> balanced(size_t n, uint64_t seed, engine eng,
+                                   bool bias = false)
+{
+    switch (eng) {
+    case engine::mt19937:
+        return balanced(n, seed, bias);
+    case engine::xoshiro256x8:
+        return detail::balanced(n, std::make_unique<xoshiro256x8>(seed),
+                                bias);
+    }
+    throw std::runtime_error("unknown random engine");
+}
+
+} // namespace views
+
+#endif
@@ -0,0 +1,128 @@
+#ifdef TESTING
+#include <map>
+#include <random>
+#include <vector>
+
+#include "balance.hpp"
+#include "doctest.h"
+#include "xoshiro.hpp"
+
+static_assert(std::uniform_random_bit_generator<xoshiro256x8>);
+
+namespace {
+
+// the reference xoshiro256++, one stream
+struct xoshiro256pp {
+    uint64_t s[4];
+
+    explicit xoshiro256pp(uint64_t seed)
+    {
+        for (auto& w : s) {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            w = z ^ (z >> 31);
+        }
+    }
+
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t operator()()
+    {
+        uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+};
+
+} // namespace
+
+TEST_CASE("xoshiro256x8")
+{
+    SUBCASE("lane 0 is xoshiro256++")
+    {
+        xoshiro256x8 g(42);
+        xoshiro256pp ref(42);
+        for (int i = 0; i < 100; ++i) {
+            uint64_t lanes[8];
+            for (auto& w : lanes) {
+                w = g();
+            }
+            CHECK_EQ(lanes[0], ref());
+        }
+    }
+
+    SUBCASE("fill gives what calls would")
+    {
+        xoshiro256x8 a(7), b(7);
+        CHECK(a == b);
+        std::vector<uint64_t> filled(1001), called(1001);
+        // start part way through a step
+        CHECK_EQ(a(), b());
+        a.fill(filled);
+        for (auto& w : called) {
+            w = b();
+        }
+        CHECK(filled == called);
+        CHECK(a == b);
+        a();
+        CHECK_FALSE(a == b);
+    }
+
+    SUBCASE("lanes differ and seeds differ")
+    {
+        xoshiro256x8 a(1), b(2);
+        std::vector<uint64_t> wa(64), wb(64);
+        a.fill(wa);
+        b.fill(wb);
+        CHECK(wa != wb);
+        std::map<uint64_t, int> seen;
+        for (auto w : wa) {
+            ++seen[w];
+        }
+        CHECK_EQ(seen.size(), wa.size());
+    }
+
+    SUBCASE("stands in for mt19937")
+    {
+        xoshiro256x8 g(3);
+        symbols s(50);
+        s.scramble(g);
+        s.cut_and_splice();
+        CHECK(s.is_balanced());
+
+        std::vector<symbols> batch(100, symbols(20));
+        symbols::scramble_batch(batch, g);
+        size_t balanced = 0;
+        for (auto& b : batch) {
+            b.cut_and_splice();
+            balanced += b.is_balanced();
+        }
+        CHECK_EQ(balanced, 100);
+
+        // each bit about half the time
+        std::vector<int> ones(64, 0);
+        const int draws = 1 << 14;
+        for (int i = 0; i < draws; ++i) {
+            uint64_t w = g();
+            for (int b = 0; b < 64; ++b) {
+                ones[b] += (w >> b) & 1;
+            }
+        }
+        for (int b = 0; b < 64; ++b) {
+            CHECK_EQ(double(ones[b]) / draws, doctest::Approx(0.5).epsilon(0.05));
+        }
+    }
+}
+
+#endif
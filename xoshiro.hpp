@@ -0,0 +1,146 @@
+#ifndef XOSHIRO_HPP
+#define XOSHIRO_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+
+// eight xoshiro256++ generators stepped together, one per lane of a vector.
+//
+// a drop-in `std::uniform_random_bit_generator` of 64 bit words, so it can
+// stand in for `std::mt19937` anywhere, with a `fill` that writes a whole
+// block of words at a time for the batch scramblers (`scramble_batch`).
+//
+// the lanes are gcc vector extensions, so the compiler uses the widest
+// registers it is allowed to: two AVX-512 or four AVX2 (-march=native), or
+// SSE2 by default. either way every step makes eight words.
+//
+// lane 0 is seeded with splitmix64 of the seed and each lane after is the
+// one before jumped 2^128 steps ahead, so the lanes never overlap. words
+// come out a step at a time, lane 0 first.
+class xoshiro256x8 {
+public:
+    using result_type = uint64_t;
+    static constexpr size_t LANES = 8;
+
+    explicit xoshiro256x8(uint64_t seed = 0) { this->seed(seed); }
+
+    void seed(uint64_t seed)
+    {
+        uint64_t lane[4];
+        for (auto& w : lane) {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            w = z ^ (z >> 31);
+        }
+        for (size_t l = 0; l < LANES; ++l) {
+            for (size_t k = 0; k < 4; ++k) {
+                s[k][l] = lane[k];
+            }
+            jump(lane);
+        }
+        used = LANES;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        if (used == LANES) {
+            std::memcpy(out, &step(), sizeof(out));
+            used = 0;
+        }
+        return out[used++];
+    }
+
+    // the next `words.size()` words, as many calls would give them
+    void fill(std::span<result_type> words)
+    {
+        size_t i = 0;
+        while (i < words.size() && used < LANES) {
+            words[i++] = out[used++];
+        }
+        for (; i + LANES <= words.size(); i += LANES) {
+            std::memcpy(&words[i], &step(), sizeof(out));
+        }
+        // the rest from one more step, the buffer being empty by now
+        if (size_t rest = words.size() - i; rest > 0) {
+            std::memcpy(out, &step(), sizeof(out));
+            std::copy_n(out, rest, &words[i]);
+            used = rest;
+        }
+    }
+
+    // true if both will give the same words from here on
+    bool operator==(const xoshiro256x8& o) const
+    {
+        return std::memcmp(s, o.s, sizeof(s)) == 0 && used == o.used &&
+               std::equal(out + used, out + LANES, o.out + used);
+    }
+
+private:
+    typedef uint64_t lanes __attribute__((vector_size(8 * LANES)));
+
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    // advances every lane one step, returning their words
+    const lanes& step()
+    {
+        // rotl(s0 + s3, 23) + s0, rotations written out so no vector is
+        // passed by value
+        lanes sum = s[0] + s[3];
+        res = ((sum << 23) | (sum >> 41)) + s[0];
+        lanes t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = (s[3] << 45) | (s[3] >> 19);
+        return res;
+    }
+
+    // one xoshiro256 state, 2^128 steps on
+    static void jump(uint64_t (&st)[4])
+    {
+        static constexpr uint64_t JUMP[] = {
+            0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+            0xa9582618e03fc9aaull, 0x39abdc4529b1661cull};
+        uint64_t j[4] = {0, 0, 0, 0};
+        for (uint64_t bits : JUMP) {
+            for (int b = 0; b < 64; ++b) {
+                if (bits & (1ull << b)) {
+                    for (size_t k = 0; k < 4; ++k) {
+                        j[k] ^= st[k];
+                    }
+                }
+                uint64_t t = st[1] << 17;
+                st[2] ^= st[0];
+                st[3] ^= st[1];
+                st[1] ^= st[2];
+                st[0] ^= st[3];
+                st[2] ^= t;
+                st[3] = rotl(st[3], 45);
+            }
+        }
+        std::copy(j, j + 4, st);
+    }
+
+    lanes s[4];
+    lanes res;
+    uint64_t out[LANES];
+    size_t used = LANES;
+};
+
+#endif